@@ -2,6 +2,7 @@ set(SRC_DIR ${CMAKE_CURRENT_SOURCE_DIR}/shader/glsl)
 file(GLOB_RECURSE SHADER_SOURCE_FILES RELATIVE ${SRC_DIR} 
                                         "${SRC_DIR}/*.vert"
                                         "${SRC_DIR}/*.frag"
+                                        "${SRC_DIR}/*.comp"
 )
 
 set(DST_DIR ${CMAKE_CURRENT_SOURCE_DIR}/shader/generated)
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+
+#include "vulkan/vulkan.hpp"
+#include "glm/glm.hpp"
+#include "sprite_batch.hpp"
+
+
+namespace vulkan2d{
+
+/*对比每个对象单独vkAllocateMemory与VMA子分配的分配/释放吞吐量*/
+void benchmarkAllocation(uint32_t count=4000, vk::DeviceSize size=256);
+
+/*精灵压力场景：大量在窗口内反弹、旋转的粒子，每帧全部提交给SpriteBatch，每秒输出一次精灵数/批次数/CPU耗时。
+  GPU驱动模式下粒子以当前位置静止地放入SpriteScene，CPU每帧不再逐个提交*/
+class SpriteBenchmark{
+public:
+    SpriteBenchmark(uint32_t count=500000);
+
+    void update(SpriteBatch& batch, const Texture& texture);
+    void setGpuDriven(bool gpuDriven);
+    bool isGpuDriven() const { return m_gpuDriven; }
+
+private:
+    struct Particle{
+        glm::vec2 position;
+        glm::vec2 velocity;
+        float     rotation;
+        float     spin;
+        uint32_t  color;
+    };
+
+    std::vector<Particle> m_particles;
+    std::chrono::high_resolution_clock::time_point m_lastTime;
+    std::chrono::high_resolution_clock::time_point m_reportTime;
+    double                m_cpuMs;      /*统计周期内update的累计耗时*/
+    uint32_t              m_frames;
+    bool                  m_gpuDriven;
+
+};
+
+
+
+}
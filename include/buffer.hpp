@@ -1,27 +1,54 @@
 #pragma once
 
 #include "vulkan/vulkan.hpp"
+#include "vk_mem_alloc.h"
+#include "memory_allocator.hpp"
+#include "defragmenter.hpp"
 
 
 namespace vulkan2d{
 
-struct Buffer{
-    vk::Buffer       buffer;
-    size_t           size;
-    vk::DeviceMemory memory;
-    size_t           memorySize;
-    void*            data;
+struct Buffer : public Relocatable{
+    vk::Buffer              buffer;
+    vk::BufferUsageFlags    usage;
+    vk::DeviceAddress       address;            /*缓冲的设备地址（仅eShaderDeviceAddress用途有效）*/
+    size_t                  size;
+    vk::DeviceMemory        memory;             /*子分配所在的内存块*/
+    vk::DeviceSize          offset;             /*子分配在内存块中的偏移*/
+    size_t                  memorySize;
+    void*                   data;
+    VmaAllocation           allocation;
+    uint32_t                memoryType;         /*实际选中的内存类型索引*/
+    vk::MemoryPropertyFlags memoryProperties;   /*实际选中的内存类型属性*/
+    MemoryCategory          category;           /*显存统计分类（由缓冲用途推断）*/
 
 
     Buffer(vk::BufferUsageFlags usage, size_t size, vk::MemoryPropertyFlags properties);
+    Buffer(vk::BufferUsageFlags usage, size_t size, MemoryUsage memoryUsage);
     ~Buffer();
 
+    bool isCoherent() const { return bool(memoryProperties & vk::MemoryPropertyFlagBits::eHostCoherent); }
+    void flush(vk::DeviceSize offset=0, vk::DeviceSize size=VK_WHOLE_SIZE);
+    void invalidate(vk::DeviceSize offset=0, vk::DeviceSize size=VK_WHOLE_SIZE);
+
+    void recordRelocation(vk::CommandBuffer cmdBuffer, VmaAllocation dstAllocation) override;
+    std::function<void()> commitRelocation() override;
+    void refreshAllocation() override;
+
+private:
+    vk::Buffer              m_relocatedBuffer;  /*碎片整理时在新位置重建的缓冲*/
+
+    void createBuffer(vk::BufferUsageFlags usage, size_t size);
+    vk::DeviceAddress queryAddress() const;
+    void allocateMemory(const std::vector<uint32_t>& candidates);
+
 };
 
 uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
+MemoryCategory categorizeBuffer(vk::BufferUsageFlags usage);
 
 
 
 
 
-}
\ No newline at end of file
+}
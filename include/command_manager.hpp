@@ -1,25 +1,38 @@
 #pragma once
 
+#include <vector>
+
 #include "vulkan/vulkan.hpp"
 
 
 namespace vulkan2d{
 
+/*按帧复用的命令缓冲：每个in-flight槽位一个瞬时命令池，槽位上的帧在GPU完成后整池复位（resetCommandPool），
+  已分配的命令缓冲保留下来按顺序重新取用，稳态下不再分配新的命令池/命令缓冲。
+  命令池需外部同步，每个录制线程使用各自的实例*/
 class CommandManager{
 public:
-    CommandManager();
+    CommandManager(uint32_t queueFamily);
     ~CommandManager();
 
-    std::vector<vk::CommandBuffer> allocateCommandBuffers(uint32_t count);
-    void freeCommandBuffers();
+    void beginFrame(uint32_t slot);
+    vk::CommandBuffer allocateCommandBuffer(vk::CommandBufferLevel level=vk::CommandBufferLevel::ePrimary);
 
 private:
-    vk::CommandPool m_pool;
+    struct FramePool{
+        vk::CommandPool                pool;
+        std::vector<vk::CommandBuffer> primary;         /*该池已分配的主命令缓冲*/
+        std::vector<vk::CommandBuffer> secondary;       /*该池已分配的辅助命令缓冲*/
+        size_t                         usedPrimary;     /*本帧已取用的数量*/
+        size_t                         usedSecondary;
+    };
+
+    uint32_t               m_queueFamily;
+    std::vector<FramePool> m_frames;
+    uint32_t               m_current;
 
     vk::CommandPool createCommandPool();
 
-
-
 };
 
 
@@ -30,4 +43,4 @@ private:
 
 
 
-}
\ No newline at end of file
+}
@@ -1,30 +1,87 @@
 #pragma once
 
+#include <deque>
+#include <vector>
+#include <functional>
+
 #include "vulkan/vulkan.hpp"
+#include "timeline.hpp"
+#include "resource_tracker.hpp"
 
 
 namespace vulkan2d{
 
+/*批处理提交的完成令牌：即该批次在所在队列时间线上发出的值*/
+struct CommandToken{
+    uint64_t value = 0;     /*0表示没有需要等待的提交*/
+};
+
+/*跨队列交接：图形队列需等待专用队列时间线到达的值，以及图形队列上需要补录的所有权获取屏障*/
+struct QueueHandoff{
+    vk::Semaphore                       timeline;
+    uint64_t                            value = 0;  /*0表示没有需要等待的提交*/
+    std::vector<vk::ImageMemoryBarrier> acquireBarriers;
+};
+
 class Commander{
 public:
-    Commander();
+    Commander(uint32_t queueFamily, vk::Queue queue, Timeline& timeline);
     ~Commander();
 
+    /*同步接口：提交后阻塞等待完成*/
     void copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size);
     void copyBuffer(vk::Buffer srcBuffer, vk::Image dstImage, uint32_t width, uint32_t height);
     void transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+    void execute(const std::function<void(vk::CommandBuffer)>& record);
+
+    /*批处理接口：任意数量的拷贝和布局变换记录进同一命令缓冲，一次提交并返回令牌，不阻塞*/
+    void beginBatch();
+    void recordCopy(vk::Buffer src, vk::Buffer dst, const vk::BufferCopy& region);
+    void recordCopy(vk::Buffer src, vk::Image dst, const vk::BufferImageCopy& region);
+    void recordLayoutTransition(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+    void recordCommands(const std::function<void(vk::CommandBuffer)>& record);
+    CommandToken submitBatch();
+    CommandToken submitAsync(const std::function<void(vk::CommandBuffer)>& record);
+
+    /*队列族所有权转移：在本队列记录释放屏障，对应的获取屏障交由图形队列在使用前记录*/
+    void recordRelease(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t dstQueueFamily);
+    QueueHandoff takeHandoff();
+    bool hasHandoff() const { return m_handoff.value>0; }     /*有已提交、尚未被图形队列接收的所有权转移*/
+    uint32_t getQueueFamily() const { return m_queueFamily; }
+
+    bool isComplete(CommandToken token);
+    void wait(CommandToken token);
+    uint32_t getSubmitCount() const { return m_submitCount; }
+
+    static void recordTransition(vk::CommandBuffer cmdBuffer, vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
 
 private:
-    vk::Fence         m_fence;
-    vk::CommandPool   m_pool;
-    vk::CommandBuffer m_cmdBuffer;
+    struct Batch{
+        vk::CommandPool   pool;         /*每个批次独占一个瞬时命令池，完成后整池复位*/
+        vk::CommandBuffer cmdBuffer;
+    };
+    struct Submission{
+        uint64_t token;
+        Batch    batch;
+    };
+
+    uint32_t               m_queueFamily;
+    vk::Queue              m_queue;
+    Timeline&              m_timeline;          /*所在队列的时间线（与该队列上的其它提交者共用）*/
+    bool                   m_crossQueue;        /*与图形队列族不同：提交的批次需要交接给图形队列*/
+    vk::CommandPool        m_batchPool;         /*正在录制的批次所在命令池*/
+    vk::CommandBuffer      m_cmdBuffer;         /*正在录制的批处理命令缓冲（未录制时为空）*/
+    std::deque<Submission> m_inflight;          /*已提交、尚未确认完成的批次（按提交顺序）*/
+    std::vector<Batch>     m_free;              /*已完成并复位、可复用的批次*/
+    std::vector<vk::CommandPool> m_pools;       /*创建过的所有命令池（销毁时统一释放）*/
+    uint32_t               m_submitCount;       /*累计提交次数*/
+    std::vector<vk::ImageMemoryBarrier> m_batchAcquires;   /*当前批次释放的资源在目的队列上的获取屏障*/
+    QueueHandoff           m_handoff;           /*已提交、尚未被图形队列接收的交接*/
 
-    void beginSingleTimeCommands();
-    void endSingleTimeCommands();
-    void submit();
+    void collect();
 
 };
 
 
 
-}
\ No newline at end of file
+}
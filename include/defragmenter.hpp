@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "vulkan/vulkan.hpp"
+#include "vk_mem_alloc.h"
+
+
+namespace vulkan2d{
+
+/*可被碎片整理移动的资源：其VmaAllocation的pUserData指向该对象*/
+class Relocatable{
+public:
+    virtual ~Relocatable() = default;
+
+    /*在目标分配处重建资源并记录从旧资源拷贝数据的命令*/
+    virtual void recordRelocation(vk::CommandBuffer cmdBuffer, VmaAllocation dstAllocation) = 0;
+    /*拷贝完成后切换到新资源，返回旧资源的销毁函数（交给延迟销毁队列，使用旧资源的帧完成后执行）*/
+    virtual std::function<void()> commitRelocation() = 0;
+    /*pass结束后allocation已指向新内存，刷新缓存的内存信息*/
+    virtual void refreshAllocation() = 0;
+};
+
+struct DefragmentationStats{
+    uint32_t       passCount;
+    uint32_t       allocationsMoved;
+    vk::DeviceSize bytesMoved;
+    vk::DeviceSize bytesFreed;
+    uint32_t       blocksFreed;
+};
+
+/*在线碎片整理：每帧推进一步的状态机。空闲帧中开始一个pass并用GPU拷贝移动资源，
+  新资源立即被后续帧使用，旧资源和旧内存在引用它们的帧完成后才释放*/
+class Defragmenter{
+public:
+    Defragmenter(float threshold=0.25f, uint32_t checkInterval=600, vk::DeviceSize maxBytesPerPass=16*1024*1024, uint32_t maxAllocationsPerPass=64);
+    ~Defragmenter();
+
+    void update(uint64_t frameNumber, uint64_t completedFrame);
+    void request() { m_requested = true; }
+    bool release(VmaAllocation allocation);
+    bool isRunning() const { return m_state!=State::eIdle; }
+    const DefragmentationStats& getLastStats() const { return m_lastStats; }
+
+private:
+    enum class State{
+        eIdle,      /*未进行整理，定期检查碎片率*/
+        eReady,     /*整理中，可以开始下一个pass*/
+        eWaiting,   /*pass的拷贝已完成，等待仍在使用旧资源的帧结束*/
+    };
+    struct Move{
+        Relocatable*  owner;
+        uint32_t      index;    /*在pass移动列表中的索引*/
+    };
+
+    State                              m_state;
+    float                              m_threshold;
+    uint32_t                           m_checkInterval;
+    uint32_t                           m_idleFrames;
+    bool                               m_requested;
+    vk::DeviceSize                     m_maxBytesPerPass;
+    uint32_t                           m_maxAllocationsPerPass;
+    VmaDefragmentationContext          m_context;
+    VmaDefragmentationPassMoveInfo     m_pass;
+    uint64_t                           m_passFrame;    /*最后可能引用旧资源的帧号*/
+    std::vector<Move>                  m_moves;
+    DefragmentationStats               m_lastStats;
+
+    void begin();
+    void beginPass(uint64_t frameNumber);
+    void endPass();
+    void finish();
+
+};
+
+
+
+}
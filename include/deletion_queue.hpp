@@ -0,0 +1,42 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <functional>
+
+#include "vulkan/vulkan.hpp"
+
+
+namespace vulkan2d{
+
+/*延迟销毁队列：资源被替换后不立即销毁，而是记录当前帧号，
+  待使用它的所有帧在GPU上完成后再执行销毁*/
+class DeletionQueue{
+public:
+    DeletionQueue();
+    ~DeletionQueue();
+
+    void push(std::function<void()> deleter);
+    template<typename T>
+    void retire(std::unique_ptr<T> object)
+    {
+        std::shared_ptr<T> shared(std::move(object));
+        push([shared]() mutable { shared.reset(); });
+    }
+    void collect(uint64_t completedFrame);
+    void flush();
+
+    size_t size() const { return m_entries.size(); }
+
+private:
+    struct Entry{
+        uint64_t              frame;    /*最后可能使用该资源的帧号*/
+        std::function<void()> deleter;
+    };
+    std::deque<Entry> m_entries;
+
+};
+
+
+
+}
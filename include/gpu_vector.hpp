@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "vulkan/vulkan.hpp"
+#include "buffer.hpp"
+
+
+namespace vulkan2d{
+
+/*GpuVector的非模板部分：管理设备本地缓冲、按字节记录脏区间并通过暂存环上传*/
+class GpuVectorBase{
+public:
+    vk::Buffer getBuffer() const { return m_buffer ? m_buffer->buffer : vk::Buffer(); }
+    vk::DeviceAddress getDeviceAddress() const { return m_buffer ? m_buffer->address : 0; }
+    vk::DeviceSize getCapacityBytes() const { return m_capacity; }
+    vk::DeviceSize getUploadedBytes() const { return m_uploadedBytes; }
+
+protected:
+    static constexpr vk::DeviceSize minCapacity = 256;     /*空数组也分配缓冲：录制命令时总能绑定有效句柄*/
+
+    GpuVectorBase(vk::BufferUsageFlags usage, vk::DeviceSize capacity);
+    ~GpuVectorBase();
+
+    void markDirty(vk::DeviceSize begin, vk::DeviceSize end);
+    void upload(const void* data, vk::DeviceSize bytes);
+
+private:
+    std::unique_ptr<Buffer>                               m_buffer;
+    vk::BufferUsageFlags                                  m_usage;
+    vk::DeviceSize                                        m_capacity;
+    vk::DeviceSize                                        m_uploadedBytes;  /*上一次upload实际上传的字节数*/
+    std::vector<std::pair<vk::DeviceSize,vk::DeviceSize>> m_dirtyRanges;    /*[begin,end)字节区间*/
+
+    void grow(vk::DeviceSize bytes);
+
+};
+
+/*可增长的设备本地数组：CPU端保存完整副本并记录修改过的元素区间，
+  每帧upload时只把脏区间写入暂存环；容量不足时按2倍扩容并整体重新上传*/
+template<typename T>
+class GpuVector : public GpuVectorBase{
+public:
+    GpuVector(vk::BufferUsageFlags usage, size_t capacity=0) : GpuVectorBase(usage, capacity*sizeof(T)) { m_data.reserve(capacity); }
+
+    size_t size() const { return m_data.size(); }
+    bool empty() const { return m_data.empty(); }
+    const T* data() const { return m_data.data(); }
+    const T& operator[](size_t index) const { return m_data[index]; }
+
+    void set(size_t index, const T& value)
+    {
+        m_data[index] = value;
+        markDirty(index*sizeof(T), (index+1)*sizeof(T));
+    }
+    T& edit(size_t index)
+    {
+        markDirty(index*sizeof(T), (index+1)*sizeof(T));
+        return m_data[index];
+    }
+    void push_back(const T& value)
+    {
+        m_data.push_back(value);
+        markDirty((m_data.size()-1)*sizeof(T), m_data.size()*sizeof(T));
+    }
+    void resize(size_t count)
+    {
+        size_t oldCount = m_data.size();
+        m_data.resize(count);
+        if(count>oldCount)
+            markDirty(oldCount*sizeof(T), count*sizeof(T));
+    }
+    void clear() { m_data.clear(); }
+    template<typename Iterator>
+    void assign(Iterator first, Iterator last)
+    {
+        m_data.assign(first, last);
+        markDirty(0, m_data.size()*sizeof(T));
+    }
+
+    void upload() { GpuVectorBase::upload(m_data.data(), m_data.size()*sizeof(T)); }
+
+private:
+    std::vector<T> m_data;
+
+};
+
+
+
+}
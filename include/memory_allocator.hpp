@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+
+#include "vulkan/vulkan.hpp"
+#include "vk_mem_alloc.h"
+
+
+namespace vulkan2d{
+
+/*内存用途：决定内存类型的选择策略*/
+enum class MemoryUsage{
+    eGpuOnly,   /*仅GPU访问（顶点/索引/纹理）：优先DEVICE_LOCAL*/
+    eUpload,    /*CPU顺序写入一次、GPU读取（暂存缓冲）：优先非DEVICE_LOCAL的主机内存，节省BAR空间*/
+    eDynamic,   /*CPU每帧写入、GPU读取（uniform/动态顶点）：优先DEVICE_LOCAL|HOST_VISIBLE（ReBAR）*/
+    eReadback,  /*GPU写入、CPU读取：优先HOST_CACHED*/
+};
+
+/*显存统计分类（按子系统）*/
+enum class MemoryCategory{
+    eVertex,
+    eIndex,
+    eUniform,
+    eStaging,
+    eTexture,
+    eRenderTarget,
+    eOther,
+    eCount
+};
+
+struct CategoryStats{
+    uint32_t       count;
+    vk::DeviceSize bytes;
+};
+
+struct HeapBudget{
+    vk::MemoryHeapFlags flags;
+    vk::DeviceSize      size;               /*堆总大小*/
+    vk::DeviceSize      budget;             /*系统给出的可用预算（VK_EXT_memory_budget，不支持时为估算值）*/
+    vk::DeviceSize      usage;              /*当前进程在该堆上的实际占用*/
+    vk::DeviceSize      blockBytes;         /*本分配器在该堆上分配的内存块大小*/
+    vk::DeviceSize      allocationBytes;    /*本分配器在该堆上的子分配大小*/
+};
+
+struct MemoryStats{
+    uint32_t       blockCount;          /*vk::DeviceMemory块数量（即实际调用vkAllocateMemory的次数）*/
+    uint32_t       allocationCount;     /*从块中划分出的子分配数量*/
+    vk::DeviceSize blockBytes;          /*所有块占用的显存大小*/
+    vk::DeviceSize allocationBytes;     /*子分配实际使用的显存大小*/
+    uint32_t       unusedRangeCount;    /*块内空闲区间数量*/
+    vk::DeviceSize largestFreeRange;    /*最大的连续空闲区间*/
+    float          fragmentation;       /*碎片率：1-最大空闲区间/总空闲大小（0表示空闲空间完全连续）*/
+};
+
+/*待刷新/失效的映射内存区间（相对分配起始位置）*/
+struct MappedRange{
+    VmaAllocation  allocation;
+    vk::DeviceSize offset;
+    vk::DeviceSize size;
+};
+
+class MemoryAllocator{
+public:
+    MemoryAllocator(vk::DeviceSize blockSize=64*1024*1024);
+    ~MemoryAllocator();
+
+    VmaAllocator getHandle() const { return m_allocator; }
+    const vk::PhysicalDeviceMemoryProperties& getMemoryProperties() const { return m_memoryProperties; }
+    MemoryStats getStats();
+    void printStats();
+    void newFrame();
+
+    void track(MemoryCategory category, vk::DeviceSize bytes);
+    void untrack(MemoryCategory category, vk::DeviceSize bytes);
+    CategoryStats getCategoryStats(MemoryCategory category) const { return m_categoryStats[static_cast<size_t>(category)]; }
+    std::vector<HeapBudget> getHeapBudgets();
+    std::string dumpStatsJson();
+    void writeStatsJson(const std::string& filename);
+    static const char* categoryName(MemoryCategory category);
+
+    std::vector<uint32_t> rankMemoryTypes(uint32_t typeBits, MemoryUsage usage) const;
+    std::vector<uint32_t> filterMemoryTypes(uint32_t typeBits, vk::MemoryPropertyFlags properties) const;
+    VmaAllocation allocateBuffer(vk::Buffer buffer, const std::vector<uint32_t>& candidates, VmaAllocationInfo& info);
+    VmaAllocation allocateImage(vk::Image image, const std::vector<uint32_t>& candidates, VmaAllocationInfo& info);
+
+    bool isCoherent(uint32_t typeIndex) const;
+    void queueFlush(VmaAllocation allocation, vk::DeviceSize offset, vk::DeviceSize size);
+    void queueInvalidate(VmaAllocation allocation, vk::DeviceSize offset, vk::DeviceSize size);
+    void flushMappedRanges();
+    void invalidateMappedRanges();
+    void dropRanges(VmaAllocation allocation);
+
+private:
+    VmaAllocator                       m_allocator;
+    vk::PhysicalDeviceMemoryProperties m_memoryProperties;  /*缓存的内存类型/堆属性，避免每次分配都查询*/
+    std::array<CategoryStats, static_cast<size_t>(MemoryCategory::eCount)> m_categoryStats;
+    uint32_t                           m_frameIndex;
+    vk::DeviceSize                     m_nonCoherentAtomSize;
+    std::vector<MappedRange>           m_pendingFlushes;       /*本帧CPU写入、提交前需要flush的区间*/
+    std::vector<MappedRange>           m_pendingInvalidates;   /*GPU写入、CPU读取前需要invalidate的区间*/
+
+    int scoreMemoryType(uint32_t typeIndex, MemoryUsage usage) const;
+    VmaAllocationCreateInfo createInfoForType(uint32_t typeIndex) const;
+    void queueRange(std::vector<MappedRange>& ranges, VmaAllocation allocation, vk::DeviceSize offset, vk::DeviceSize size);
+    void mergeRanges(std::vector<MappedRange>& ranges);
+
+};
+
+
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "vulkan/vulkan.hpp"
+
+
+namespace vulkan2d{
+
+struct Texture;
+
+/*mipmap生成：第0层上传完成后在图形队列上逐层降采样生成完整mip链。
+  格式支持线性blit时使用vkCmdBlitImage链，否则回退到计算着色器2x2盒式滤波（需要存储图像支持）*/
+class MipmapGenerator{
+public:
+    MipmapGenerator(const std::vector<char>& computeSource);
+    ~MipmapGenerator();
+
+    static uint32_t fullMipChain(uint32_t width, uint32_t height);
+    bool supportsBlit(vk::Format format) const;
+    bool supportsCompute(vk::Format format) const;
+    uint32_t maxMipLevels(vk::Format format, uint32_t width, uint32_t height) const;
+
+    void request(const Texture& texture);
+    void cancel(vk::Image image);
+    bool isPending(vk::Image image) const { return m_pending.count(static_cast<VkImage>(image))>0; }
+    bool empty() const { return m_pending.empty(); }
+    void record(vk::CommandBuffer cmdBuffer, vk::Image image);
+
+private:
+    struct MipChain{
+        vk::Format format;
+        uint32_t   width;
+        uint32_t   height;
+        uint32_t   mipLevels;
+    };
+
+    std::unordered_map<VkImage, MipChain> m_pending;   /*等待第0层上传完成的图像*/
+    vk::DescriptorSetLayout m_setLayout;
+    vk::PipelineLayout      m_pipelineLayout;
+    vk::Pipeline            m_pipeline;         /*计算回退管线（着色器载入失败时为空）*/
+    vk::Sampler             m_sampler;          /*逐texel读取上一层使用的最近邻采样器*/
+    std::vector<vk::DescriptorPool> m_descriptorPools;     /*池满时追加新池（同一帧中生成很多层级时）*/
+    bool                    m_writeWithoutFormat;   /*设备支持不声明格式写入存储图像（计算回退适用于任意可存储格式）*/
+
+    void recordBlit(vk::CommandBuffer cmdBuffer, vk::Image image, const MipChain& chain);
+    void recordCompute(vk::CommandBuffer cmdBuffer, vk::Image image, const MipChain& chain);
+    void createComputePipeline(const std::vector<char>& computeSource);
+    vk::ImageView createLevelView(vk::Image image, vk::Format format, uint32_t level);
+    vk::DescriptorPool createDescriptorPool();
+    vk::DescriptorPool allocateDescriptorSets(uint32_t count, std::vector<vk::DescriptorSet>& sets);
+
+};
+
+
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "vulkan/vulkan.hpp"
+
+
+namespace vulkan2d{
+
+/*Vulkan同步/命令对象的累计创建次数：稳态渲染下应保持不变*/
+struct ObjectCounters{
+    std::atomic<uint64_t> semaphores{0};
+    std::atomic<uint64_t> commandPools{0};
+    std::atomic<uint64_t> commandBuffers{0};
+
+    uint64_t total() const { return semaphores + commandPools + commandBuffers; }
+};
+
+ObjectCounters& objectCounters();
+
+/*二值信号量复用池：归还的对象留待下次取用，稳态下不再创建新对象。
+  帧与传输提交的完成由队列时间线判断，不再使用fence。池本身不加锁，只在主线程使用*/
+class SyncPool{
+public:
+    SyncPool();
+    ~SyncPool();
+
+    vk::Semaphore acquireSemaphore();
+    void releaseSemaphore(vk::Semaphore semaphore); /*归还前信号量上不能有挂起的等待/发出操作*/
+
+private:
+    std::vector<vk::Semaphore> m_semaphores;        /*池创建的所有信号量（销毁时统一释放）*/
+    std::vector<vk::Semaphore> m_freeSemaphores;
+
+};
+
+
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+#include "vulkan/vulkan.hpp"
+#include "command_manager.hpp"
+
+
+namespace vulkan2d{
+
+/*多线程录制辅助命令缓冲：每个工作线程持有自己的CommandManager（按槽位的命令池，无需加锁），
+  主线程把渲染流程内的绘制列表划分为若干任务，与工作线程一起从任务队列中领取并各自录制辅助命令缓冲，
+  返回的命令缓冲按任务顺序排列，由主命令缓冲executeCommands拼接（保持绘制顺序）*/
+class ParallelRecorder{
+public:
+    using Task = std::function<void(vk::CommandBuffer)>;
+
+    ParallelRecorder(uint32_t threadCount=0);
+    ~ParallelRecorder();
+
+    void beginFrame(uint32_t slot);
+    std::vector<vk::CommandBuffer> record(const vk::CommandBufferInheritanceInfo& inheritance, const std::vector<Task>& tasks);
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }    /*含主线程*/
+
+private:
+    struct Worker{
+        std::thread                     thread;
+        std::unique_ptr<CommandManager> commandManager;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex                           m_mutex;
+    std::condition_variable              m_wake;        /*新一批任务或退出*/
+    std::condition_variable              m_done;        /*工作线程完成本批任务*/
+    uint64_t                             m_generation;  /*任务批次编号*/
+    uint32_t                             m_busy;        /*仍在处理本批任务的工作线程数*/
+    bool                                 m_quit;
+    std::atomic<uint32_t>                m_nextTask;
+    const std::vector<Task>*             m_tasks;
+    const vk::CommandBufferInheritanceInfo* m_inheritance;
+    std::vector<vk::CommandBuffer>       m_results;
+    std::exception_ptr                   m_error;       /*任务抛出的第一个异常，在主线程重新抛出*/
+
+    void run(Worker& worker);
+    void drain(CommandManager& commandManager);
+
+};
+
+
+
+}
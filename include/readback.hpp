@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <deque>
+#include <future>
+#include <string>
+#include <functional>
+
+#include "vulkan/vulkan.hpp"
+#include "buffer.hpp"
+#include "resource_tracker.hpp"
+
+
+namespace vulkan2d{
+
+/*图像回读结果：行紧凑排列的像素数据*/
+struct ReadbackImage{
+    uint32_t          width = 0;
+    uint32_t          height = 0;
+    vk::Format        format = vk::Format::eUndefined;
+    std::vector<char> pixels;
+
+    static bool supportsPpm(vk::Format format);    /*8位RGBA/BGRA（每texel 4字节）*/
+    void writePpm(const std::string& filename) const;
+};
+
+/*GPU到CPU的异步回读：请求先排队，录制进下一帧的命令缓冲（渲染流程之后），
+  拷贝到HOST_CACHED暂存内存；该帧在图形队列时间线上完成后兑现future，渲染循环不阻塞*/
+class Readback{
+public:
+    Readback();
+    ~Readback();
+
+    std::future<std::vector<char>> readBuffer(vk::Buffer src, vk::DeviceSize offset, vk::DeviceSize size);
+    std::future<ReadbackImage> readImage(vk::Image src, uint32_t width, uint32_t height, vk::Format format,
+                                         uint32_t mipLevel=0, ResourceUse after=ResourceUse::eFragmentSampled);
+    std::future<ReadbackImage> captureFrame();
+    void saveScreenshot(const std::string& filename);
+
+    void record(vk::CommandBuffer cmdBuffer, vk::Image swapchainImage);
+    void submit(uint64_t timelineValue);
+    void update();
+
+    bool hasQueued() const { return !m_queued.empty(); }
+    bool empty() const { return m_queued.empty() && m_recorded.empty() && m_inflight.empty(); }
+    static vk::DeviceSize texelSize(vk::Format format);
+
+private:
+    enum class Source{
+        eBuffer,
+        eImage,
+        eSwapchain,
+    };
+
+    struct Request{
+        Source                  source;
+        vk::Buffer              buffer;
+        vk::DeviceSize          offset;
+        vk::DeviceSize          size;
+        vk::Image               image;
+        uint32_t                width;
+        uint32_t                height;
+        vk::Format              format;
+        uint32_t                mipLevel;
+        ResourceUse             after;          /*回读后图像恢复的用途*/
+        std::unique_ptr<Buffer> staging;        /*主机可见的回读目的缓冲*/
+        uint64_t                value;          /*所在帧在图形队列时间线上的值*/
+        std::function<void(Request&, std::vector<char>&&)> deliver;     /*兑现promise或执行回调*/
+    };
+
+    std::deque<Request> m_queued;       /*等待录制的请求*/
+    std::vector<Request> m_recorded;    /*已录制进当前帧、等待提交的请求*/
+    std::deque<Request> m_inflight;     /*已提交、等待GPU完成的请求（按时间线值递增）*/
+
+    std::future<ReadbackImage> queueImage(Request&& request);
+    void recordRequest(vk::CommandBuffer cmdBuffer, Request& request, vk::Image swapchainImage);
+
+};
+
+
+
+}
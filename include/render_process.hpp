@@ -1,26 +1,52 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include "vulkan/vulkan.hpp"
 #include "shader.hpp"
 
 namespace vulkan2d{
+
+/*颜色混合方式*/
+enum class BlendMode{
+    eOpaque,    /*直接覆盖*/
+    eAlpha,     /*按源alpha混合（预乘前）*/
+    eAdditive,  /*叠加（粒子/光效）*/
+};
+
+/*图形管线的可变部分：顶点输入、管线布局、混合与剔除（其余固定功能状态所有管线一致）*/
+struct PipelineConfig{
+    vk::PrimitiveTopology                            topology = vk::PrimitiveTopology::eTriangleList;
+    std::vector<vk::VertexInputBindingDescription>   bindings;      /*为空时无固定顶点输入（顶点拉取）*/
+    std::vector<vk::VertexInputAttributeDescription> attributes;
+    vk::PipelineLayout                               layout;        /*为空时使用RenderProcess::pipelineLayout*/
+    BlendMode                                        blend = BlendMode::eOpaque;
+    vk::CullModeFlags                                cullMode = vk::CullModeFlagBits::eBack;
+};
     
 class RenderProcess{
 public:
     RenderProcess();
     ~RenderProcess();
 
-    vk::Pipeline createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology topology);
+    vk::Pipeline createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology topology, bool vertexPulling=false);
+    vk::Pipeline createGraphicsPipeline(const Shader& shader, const PipelineConfig& config);
 
     vk::PipelineLayout pipelineLayout;
     vk::RenderPass     renderPass;
     vk::Pipeline       graphicsPipeline_triangle;
     vk::Pipeline       graphicsPipeline_line;
+    vk::Pipeline       graphicsPipeline_pull;   /*顶点拉取：无固定顶点输入，顶点着色器按设备地址读取*/
+    vk::PipelineLayout spritePipelineLayout;    /*精灵管线布局：set 0为uniform，set 1为纹理*/
+    vk::Pipeline       graphicsPipeline_sprite;             /*精灵：alpha混合*/
+    vk::Pipeline       graphicsPipeline_spriteAdditive;     /*精灵：叠加混合*/
+    vk::Pipeline       graphicsPipeline_spriteInstanced;            /*实例化精灵：alpha混合*/
+    vk::Pipeline       graphicsPipeline_spriteInstancedAdditive;    /*实例化精灵：叠加混合*/
 
 private:
     vk::PipelineLayout createLayout();
+    vk::PipelineLayout createSpriteLayout();
     vk::RenderPass createRenderPass();
 
 
@@ -1,40 +1,94 @@
 #pragma once
 
+#include <vector>
+#include <chrono>
+
 #include "vulkan/vulkan.hpp"
 #include "buffer.hpp"
+#include "ring_buffer.hpp"
+#include "commander.hpp"
 
 
 namespace vulkan2d{
 
 class Renderer{
 public:
-    Renderer(int maxFlightCount=5);
+    static constexpr int maxFlightCount = 3;    /*每帧资源（信号量/命令池/uniform环形缓冲区段）按此数量分配*/
+    static constexpr uint32_t parallelBatchThreshold = 64;     /*精灵批次数达到此值时多线程录制渲染流程（少于此值时线程同步开销大于收益）*/
+    static constexpr uint32_t minBatchesPerTask = 16;
+
+    Renderer(int flightCount=2);
     ~Renderer();
 
     int getFlightCount() { return m_flightCount; }
+    void setFlightCount(int flightCount);
+    double getLatency() const { return m_latencyMs; }
+    uint64_t getFrameNumber() const { return m_frameNumber; }
+    uint64_t getCompletedFrame() const { return m_completedFrame; }
+    bool isFrameComplete(uint64_t frame);
     std::vector<vk::CommandBuffer>& getCommandBuffers() { return m_commandbuffers; }
     std::vector<vk::DescriptorSet>& getDescriptorSets() { return m_descriptorSets; }
     vk::Result getSwapchainState();
 
-    void updateDescriptorSets(const std::vector<std::unique_ptr<Buffer>>& buffers);
+    void updateDescriptorSets(const RingBuffer& uniformRing);
     void drawFrame();
+    void invalidate() { m_recordVersion++; }    /*交换链、管线或已绑定的描述符集变化后调用：缓存的命令缓冲在下次使用前重新录制*/
+    uint64_t getRecordCount() const { return m_recordCount; }
 
 private:
+    /*录制帧命令时读取的、可能在不通知渲染器的情况下变化的状态（缓冲扩容或被碎片整理移动、绘制数量、uniform偏移）*/
+    struct RecordKey{
+        vk::Buffer        vertexBuffer;
+        vk::DeviceAddress vertexAddress;
+        vk::Buffer        indexBuffer;
+        uint32_t          indexCount;
+        uint32_t          uniformOffset;
+        uint32_t          spriteUniformOffset;
+        vk::Buffer        spriteQuad;
+        vk::Buffer        spriteIndices;
+        uint64_t          sceneVersion;
+
+        bool operator==(const RecordKey&) const = default;
+    };
+    struct CachedCommandBuffer{
+        vk::CommandBuffer commandBuffer;
+        uint64_t          version;      /*录制时的m_recordVersion*/
+        RecordKey         key;
+    };
+
     int                             m_currentFrame;
     uint32_t                        m_imageIndex;
-    int                             m_flightCount;
-    int                             m_maxFlightCount;
+    uint32_t                        m_uniformOffset;
+    int                             m_flightCount;      /*运行期可调的in-flight帧数（1~maxFlightCount）：少则延迟低，多则吞吐高*/
+    uint64_t                        m_frameNumber;      /*已开始录制的帧数（帧号从1开始）*/
+    uint64_t                        m_completedFrame;   /*GPU已确认完成的最大帧号*/
+    std::vector<uint64_t>           m_inflightFrameNumbers;  /*每个in-flight槽位最近提交的帧号*/
+    std::vector<uint64_t>           m_inflightValues;        /*每个in-flight槽位最近提交在图形队列时间线上发出的值*/
+    std::vector<uint64_t>           m_imageInflightValues;   /*每张交换链图像最近一次渲染的帧在时间线上的值（获取到仍在使用的图像时等待）*/
+    std::vector<std::chrono::steady_clock::time_point> m_frameStartTimes;   /*每个槽位最近一帧开始录制的时间*/
+    double                          m_latencyMs;        /*帧延迟（开始录制到GPU完成）的平滑值*/
     std::vector<vk::CommandBuffer>  m_commandbuffers;
     std::vector<vk::DescriptorSet>  m_descriptorSets;
     std::vector<vk::Semaphore>      m_imageAvailbleSemaphores;
-    std::vector<vk::Semaphore>      m_renderFinishedSemaphores;
-    std::vector<vk::Fence>          m_inflightFences;
+    std::vector<vk::Semaphore>      m_renderFinishedSemaphores;  /*按交换链图像索引：显示引擎释放该图像前不会复用*/
+    QueueHandoff                    m_handoff;          /*本帧需要从专用传输队列接收的资源*/
+    vk::CommandPool                 m_cachePool;        /*缓存的帧命令缓冲（可单独复位，不随槽位命令池每帧复位）*/
+    std::vector<std::vector<CachedCommandBuffer>> m_cachedCommandBuffers;  /*[槽位][交换链图像]*/
+    uint64_t                        m_recordVersion;
+    uint64_t                        m_recordCount;      /*累计录制帧命令的次数（静态场景下不再增长）*/
 
-    std::vector<vk::CommandBuffer> createCommandBuffers();
     std::vector<vk::DescriptorSet> createDescriptorSets();
-    void initFences();
+    void updateCompletedFrame();
     void initSemaphores();
-    void recordCommandBuffer(vk::CommandBuffer& commandBuffer, uint32_t imageIndex);
+    void trackSwapchainImages();
+    RecordKey currentRecordKey();
+    vk::CommandBuffer getCachedCommandBuffer(uint32_t imageIndex);
+    void recordHandoff(vk::CommandBuffer commandBuffer);
+    void recordReadback(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+    void recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, vk::CommandBufferUsageFlags usage);
+    void recordParallel(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+    void setViewport(vk::CommandBuffer commandBuffer);
+    void recordMesh(vk::CommandBuffer commandBuffer);
     
 
 
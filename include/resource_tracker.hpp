@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "vulkan/vulkan.hpp"
+
+
+namespace vulkan2d{
+
+/*资源的使用方式：决定访问该资源时所处的管线阶段、访问类型和图像布局*/
+enum class ResourceUse{
+    eUndefined,         /*不关心原有内容*/
+    eTransferSrc,
+    eTransferDst,
+    eVertexBuffer,
+    eIndexBuffer,
+    eIndirectBuffer,
+    eUniformBuffer,
+    eVertexShaderRead,  /*顶点着色器读取存储缓冲（顶点拉取）*/
+    eFragmentSampled,
+    eComputeSampled,
+    eComputeRead,
+    eComputeWrite,
+    eComputeReadWrite,
+    eColorAttachment,
+    ePresent,
+    eHostRead,
+};
+
+struct ResourceState{
+    vk::PipelineStageFlags2 stage;
+    vk::AccessFlags2        access;
+    vk::ImageLayout         layout;     /*仅对图像有效*/
+};
+
+/*资源状态跟踪：记录每个图像（按mip层级）/缓冲当前的布局、最近的写入和之后的读取，
+  使用资源时只生成必要的synchronization2屏障（读后读不需要屏障，已可见的读取不重复屏障），
+  同一使用点的所有屏障累积后由flush合并为一次pipelineBarrier2。
+  状态按录制顺序更新，只适用于按录制顺序提交到同一队列的命令*/
+class ResourceTracker{
+public:
+    ResourceTracker();
+    ~ResourceTracker();
+
+    static ResourceState stateOf(ResourceUse use);
+    static ResourceState stateOf(vk::ImageLayout layout);
+
+    void registerImage(vk::Image image, uint32_t mipLevels=1, vk::ImageAspectFlags aspect=vk::ImageAspectFlagBits::eColor);
+    void forget(vk::Image image);
+    void forget(vk::Buffer buffer);
+    void assume(vk::Image image, ResourceUse use);
+    void assume(vk::Buffer buffer, ResourceUse use);
+    vk::ImageLayout getLayout(vk::Image image, uint32_t mipLevel=0) const;
+
+    void useImage(vk::Image image, ResourceUse use, uint32_t baseMipLevel=0, uint32_t levelCount=VK_REMAINING_MIP_LEVELS, bool discard=false);
+    void useBuffer(vk::Buffer buffer, ResourceUse use);
+    void flush(vk::CommandBuffer cmdBuffer);
+
+    bool hasPendingBarriers() const { return !m_imageBarriers.empty() || !m_bufferBarriers.empty(); }
+    uint32_t getBarrierCount() const { return m_barrierCount; }
+
+private:
+    struct TrackedState{
+        vk::ImageLayout         layout;
+        vk::PipelineStageFlags2 writeStages;    /*最近一次写入（含布局变换）所在阶段*/
+        vk::AccessFlags2        writeAccess;    /*最近一次写入的访问类型*/
+        vk::PipelineStageFlags2 readStages;     /*最近一次写入之后读取过的阶段（写前需等待）*/
+        vk::PipelineStageFlags2 visibleStages;  /*最近一次写入已对哪些阶段可见*/
+        vk::AccessFlags2        visibleAccess;  /*最近一次写入已对哪些访问类型可见*/
+    };
+    struct TrackedImage{
+        vk::ImageAspectFlags      aspect;
+        std::vector<TrackedState> levels;
+    };
+    struct Transition{
+        vk::PipelineStageFlags2 srcStage;
+        vk::AccessFlags2        srcAccess;
+        vk::ImageLayout         oldLayout;
+    };
+
+    std::unordered_map<VkImage, TrackedImage>  m_images;
+    std::unordered_map<VkBuffer, TrackedState> m_buffers;
+    std::vector<vk::ImageMemoryBarrier2>       m_imageBarriers;    /*等待flush的图像屏障*/
+    std::vector<vk::BufferMemoryBarrier2>      m_bufferBarriers;   /*等待flush的缓冲屏障*/
+    uint32_t                                   m_barrierCount;     /*累计生成的屏障数量*/
+
+    static bool transition(TrackedState& state, const ResourceState& next, bool discard, Transition& out);
+
+};
+
+
+
+}
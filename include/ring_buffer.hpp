@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <cstring>
+
+#include "vulkan/vulkan.hpp"
+#include "buffer.hpp"
+
+
+namespace vulkan2d{
+
+struct RingAllocation{
+    vk::Buffer buffer;
+    uint32_t   offset;  /*相对整个缓冲的偏移（可直接作为dynamic offset）*/
+    void*      data;    /*已映射的写入地址*/
+};
+
+/*按帧划分的持久映射线性环形缓冲：每个in-flight帧独占一段，
+  该帧在GPU上完成后（beginFrame）整段回收，帧内分配只需移动头指针*/
+class RingBuffer{
+public:
+    RingBuffer(vk::BufferUsageFlags usage, vk::DeviceSize frameSize, uint32_t frameCount, vk::DeviceSize alignment);
+    ~RingBuffer();
+
+    void beginFrame(uint32_t frameIndex);
+    void flush();
+    RingAllocation allocate(vk::DeviceSize size);
+    template<typename T>
+    RingAllocation push(const T& value)
+    {
+        RingAllocation alloc = allocate(sizeof(T));
+        memcpy(alloc.data, &value, sizeof(T));
+        return alloc;
+    }
+
+    vk::Buffer getBuffer() const { return m_buffer->buffer; }
+    vk::DeviceSize getFrameSize() const { return m_frameSize; }
+
+private:
+    std::unique_ptr<Buffer> m_buffer;
+    vk::DeviceSize          m_frameSize;
+    vk::DeviceSize          m_alignment;
+    vk::DeviceSize          m_frameBegin;
+    vk::DeviceSize          m_head;
+    uint32_t                m_frameCount;
+
+};
+
+
+
+}
@@ -10,7 +10,8 @@ namespace vulkan2d{
 
 class Shader{
 public:
-    Shader(const std::vector<char>& vertexSource, const std::vector<char>& fragmentSource);
+    Shader(const std::vector<char>& vertexSource, const std::vector<char>& fragmentSource,
+           const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& setBindings={});
     ~Shader();
 
     vk::ShaderModule getVertexShaderModule() const { return m_vertexModule; }
@@ -23,7 +24,7 @@ private:
     vk::ShaderModule                     m_fragmentModule;
     std::vector<vk::DescriptorSetLayout> m_descriptorSetLayouts; 
 
-    void initDescriptorSetLayout();
+    void initDescriptorSetLayout(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& setBindings);
 };
 
 
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <array>
+#include <unordered_map>
+
+#include "vulkan/vulkan.hpp"
+#include "glm/glm.hpp"
+#include "ring_buffer.hpp"
+#include "gpu_vector.hpp"
+#include "render_process.hpp"
+
+
+namespace vulkan2d{
+
+struct Texture;
+
+/*精灵顶点（16字节）：位置float2、纹理坐标unorm16x2、颜色RGBA8*/
+struct SpriteVertex{
+    glm::vec2 pos;
+    uint16_t  uv[2];
+    uint32_t  color;
+
+    static std::array<vk::VertexInputBindingDescription,1> getBindingDescriptions();
+    static std::array<vk::VertexInputAttributeDescription,3> getAttributeDescriptions();
+};
+
+/*实例化路径的逐实例数据（32字节）：中心位置、尺寸、旋转角、纹理区域unorm16x4、颜色RGBA8。
+  binding 0为所有实例共用的静态单位四边形（逐顶点），binding 1为实例数据（逐实例）*/
+struct SpriteInstance{
+    glm::vec2 position;
+    glm::vec2 size;
+    float     rotation;
+    uint16_t  uvRect[4];
+    uint32_t  color;
+
+    static std::array<vk::VertexInputBindingDescription,2> getBindingDescriptions();
+    static std::array<vk::VertexInputAttributeDescription,6> getAttributeDescriptions();
+};
+
+/*精灵的提交方式：CPU展开为4个顶点，或每个精灵一条实例记录由顶点着色器展开*/
+enum class SpriteMode{
+    eExpanded,
+    eInstanced,
+};
+
+/*单个精灵：中心位置和尺寸（像素，原点在左上角）、绕中心的旋转角（弧度）、纹理区域和颜色*/
+struct Sprite{
+    glm::vec2 position;
+    glm::vec2 size;
+    float     rotation = 0.0f;
+    glm::vec4 uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);  /*u0,v0,u1,v1*/
+    uint32_t  color = 0xffffffff;                           /*RGBA8（R在最低字节）*/
+};
+
+uint32_t packColor(const glm::vec4& color);
+SpriteInstance makeInstance(const Sprite& sprite);
+
+/*精灵批处理：每帧begin/draw/end，精灵在CPU端展开为4个顶点（或一条实例记录）直接写入持久映射的按帧顶点流，
+  连续的精灵只在纹理或混合方式（管线）变化时断开批次，每个批次一次drawIndexed（共用静态四边形索引）*/
+class SpriteBatch{
+public:
+    SpriteBatch(uint32_t maxSprites=1<<19, SpriteMode mode=SpriteMode::eExpanded);
+    ~SpriteBatch();
+
+    void begin(uint32_t frameIndex);
+    void draw(const Texture& texture, const Sprite& sprite, BlendMode blend=BlendMode::eAlpha);
+    void end();
+    void record(vk::CommandBuffer cmdBuffer, vk::DescriptorSet uniformSet, uint32_t firstBatch=0, uint32_t batchCount=UINT32_MAX);
+    void forget(vk::ImageView view);
+    void setMode(SpriteMode mode) { m_nextMode = mode; }   /*下一次begin时生效*/
+
+    uint32_t getSpriteCount() const { return m_spriteCount; }
+    uint32_t getDrawCount() const { return static_cast<uint32_t>(m_batches.size()); }
+    uint32_t getMaxSprites() const { return m_maxSprites; }
+    SpriteMode getMode() const { return m_mode; }
+
+    /*供共用精灵管线的其他绘制路径（SpriteScene）使用*/
+    vk::DescriptorSet getTextureSet(const Texture& texture);
+    vk::Buffer getQuadBuffer() const { return m_quad->getBuffer(); }
+    vk::Buffer getIndexBuffer() const { return m_indices->getBuffer(); }
+    uint32_t getUniformOffset() const { return m_uniformOffset; }
+
+private:
+    static constexpr uint32_t chunkSprites = 4096;  /*每次从顶点环形缓冲取用的精灵数（各块在本帧区段内连续）*/
+
+    struct TextureSet{
+        vk::DescriptorSet  set;
+        vk::DescriptorPool pool;     /*分配该集的池（释放时归还）*/
+    };
+    struct Batch{
+        vk::DescriptorSet textureSet;
+        BlendMode         blend;
+        uint32_t          firstSprite;
+        uint32_t          spriteCount;
+    };
+
+    std::unique_ptr<RingBuffer>          m_vertices;     /*按帧划分的持久映射顶点流（两种模式共用）*/
+    std::unique_ptr<GpuVector<uint32_t>> m_indices;      /*静态四边形索引：每个精灵6个索引（0,1,2,2,3,0）*/
+    std::unique_ptr<GpuVector<glm::vec2>> m_quad;        /*实例化路径的静态单位四边形*/
+    std::vector<vk::DescriptorPool>      m_descriptorPools;  /*池满时追加新池*/
+    std::unordered_map<VkImageView, TextureSet> m_textureSets;   /*每个纹理视图一个描述符集*/
+    std::vector<Batch>                   m_batches;
+    uint32_t                             m_maxSprites;
+    uint32_t                             m_spriteCount;
+    vk::DeviceSize                       m_vertexBase;   /*本帧第一块顶点在缓冲中的偏移*/
+    char*                                m_cursor;       /*下一个精灵的写入位置*/
+    char*                                m_chunkEnd;
+    SpriteMode                           m_mode;         /*本帧的提交方式*/
+    SpriteMode                           m_nextMode;
+    uint32_t                             m_uniformOffset;
+    vk::ImageView                        m_lastView;     /*上一次draw的纹理视图（连续同纹理时跳过查表）*/
+    vk::DescriptorSet                    m_lastSet;
+
+    void nextChunk();
+    vk::DescriptorPool createDescriptorPool();
+    TextureSet allocateTextureSet();
+    vk::DeviceSize spriteBytes() const { return m_mode==SpriteMode::eInstanced ? sizeof(SpriteInstance) : 4*sizeof(SpriteVertex); }
+
+};
+
+
+
+}
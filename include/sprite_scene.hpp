@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <array>
+
+#include "vulkan/vulkan.hpp"
+#include "glm/glm.hpp"
+#include "buffer.hpp"
+#include "gpu_vector.hpp"
+#include "sprite_batch.hpp"
+#include "renderer.hpp"
+
+
+namespace vulkan2d{
+
+struct Texture;
+
+/*GPU驱动的精灵场景：对象数据常驻存储缓冲（只上传修改过的对象），每帧由计算着色器对可见区域剔除，
+  为每个可见对象写入一条vk::DrawIndexedIndirectCommand并累加绘制数量，渲染时一次drawIndexedIndirectCount。
+  帧的CPU开销与对象数量无关。绘制使用实例化精灵管线，firstInstance即对象在存储缓冲中的下标*/
+class SpriteScene{
+public:
+    SpriteScene(const std::vector<char>& cullSource, bool drawIndirectCount);
+    ~SpriteScene();
+
+    uint32_t add(const Sprite& sprite);
+    void set(uint32_t id, const Sprite& sprite);
+    void clear();
+    void setTexture(const Texture& texture, BlendMode blend=BlendMode::eAlpha);
+    void setView(const glm::vec4& viewRect) { m_viewRect = viewRect; m_version++; }    /*x0,y0,x1,y1（像素），默认为整个窗口*/
+
+    void upload();
+    void cull(vk::CommandBuffer cmdBuffer, uint32_t frameIndex);
+    void record(vk::CommandBuffer cmdBuffer, vk::DescriptorSet uniformSet);
+
+    uint32_t getObjectCount() const { return static_cast<uint32_t>(m_objects->size()); }
+    bool usesDrawCount() const { return m_drawIndirectCount; }
+    uint64_t getVersion() const { return m_version; }     /*影响录制命令的状态变化时递增*/
+
+private:
+    struct CullConstants{
+        glm::vec4 viewRect;
+        uint32_t  objectCount;
+        uint32_t  compact;
+    };
+    struct BoundBuffers{
+        vk::Buffer objects;
+        vk::Buffer commands;
+        vk::Buffer count;
+    };
+
+    std::unique_ptr<GpuVector<SpriteInstance>> m_objects;       /*对象数据（实例化管线的binding 1，同时作为剔除的输入）*/
+    std::unique_ptr<Buffer>  m_commands;        /*剔除输出的间接绘制命令*/
+    std::unique_ptr<Buffer>  m_count;           /*剔除输出的绘制数量*/
+    uint32_t                 m_commandCapacity;
+    uint32_t                 m_uploadedCount;   /*已上传到GPU的对象数量（本帧剔除和绘制的范围）*/
+    uint32_t                 m_maxDrawCount;    /*设备允许的单次间接绘制数量上限*/
+    bool                     m_drawIndirectCount;   /*不支持drawIndexedIndirectCount时每个对象一条命令，不可见对象instanceCount为0*/
+    const Texture*           m_texture;
+    vk::DescriptorSet        m_textureSet;      /*在主线程的cull中取得，record可在录制线程上执行*/
+    BlendMode                m_blend;
+    glm::vec4                m_viewRect;
+    uint64_t                 m_version;
+    BoundBuffers             m_lastBuffers;     /*上一次upload时的缓冲句柄*/
+
+    vk::DescriptorSetLayout  m_setLayout;
+    vk::PipelineLayout       m_pipelineLayout;
+    vk::Pipeline             m_pipeline;
+    vk::DescriptorPool       m_descriptorPool;
+    std::array<vk::DescriptorSet, Renderer::maxFlightCount> m_sets;     /*每个in-flight帧一个，缓冲重建后在该帧重新写入*/
+    std::array<BoundBuffers, Renderer::maxFlightCount>      m_boundBuffers;
+
+    void createPipeline(const std::vector<char>& cullSource);
+    void reserveCommands(uint32_t count);
+    void updateSet(uint32_t frameIndex);
+
+};
+
+
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <deque>
+
+#include "vulkan/vulkan.hpp"
+#include "buffer.hpp"
+#include "commander.hpp"
+
+
+namespace vulkan2d{
+
+/*持久映射的主机可见暂存环：上传数据直接写入映射内存并记录待执行的拷贝，
+  flush时将所有拷贝合并到一个命令缓冲中异步提交，按提交返回的令牌在GPU完成后回收暂存空间。
+  存在专用传输队列时图像上传提交到传输队列并转移所有权给图形队列；缓冲的增量更新会覆盖in-flight帧
+  正在读取的数据，仍在图形队列上按提交顺序执行*/
+class StagingBelt{
+public:
+    StagingBelt(vk::DeviceSize capacity=32*1024*1024);
+    ~StagingBelt();
+
+    void uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+    void uploadImage(vk::Image dst, uint32_t width, uint32_t height, const void* data, vk::DeviceSize size);
+    void uploadImageRows(vk::Image dst, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount, const void* data, vk::DeviceSize rowPitch);
+    void flush();
+    void wait();
+
+    bool empty() const { return m_bufferCopies.empty() && m_imageCopies.empty() && m_preTransitions.empty() && m_postTransitions.empty(); }
+
+private:
+    struct BufferCopy{
+        vk::Buffer     dst;
+        vk::BufferCopy region;
+    };
+    struct ImageCopy{
+        vk::Image           dst;
+        vk::BufferImageCopy region;
+    };
+
+    struct InflightRegion{
+        CommandToken   token;           /*图形队列上的提交*/
+        CommandToken   transferToken;   /*专用传输队列上的提交*/
+        vk::DeviceSize end;             /*该次提交使用的暂存区间终点（完成后尾指针移动到此）*/
+    };
+
+    std::unique_ptr<Buffer>  m_buffer;
+    vk::DeviceSize           m_capacity;
+    vk::DeviceSize           m_head;            /*下一次写入位置*/
+    vk::DeviceSize           m_tail;            /*最早仍被使用的位置*/
+    vk::DeviceSize           m_pendingBegin;    /*尚未提交的数据起点*/
+    std::deque<InflightRegion> m_inflight;
+    std::vector<BufferCopy>  m_bufferCopies;
+    std::vector<ImageCopy>   m_imageCopies;
+    std::vector<vk::Image>   m_preTransitions;     /*拷贝前需转换为TransferDst布局的图像*/
+    std::vector<vk::Image>   m_postTransitions;    /*拷贝后需转换为ShaderReadOnly布局的图像*/
+
+    bool unused() const { return m_inflight.empty() && m_head==m_pendingBegin; }
+    bool isComplete(const InflightRegion& region);
+    void reclaim();
+    void makeRoom();
+    vk::DeviceSize available(vk::DeviceSize alignment);
+    vk::DeviceSize reserve(vk::DeviceSize size, vk::DeviceSize alignment);
+
+};
+
+
+
+}
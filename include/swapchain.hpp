@@ -32,7 +32,7 @@ public:
     std::vector<Image>           images;
     std::vector<vk::Framebuffer> framebuffers;
 
-    Swapchain(vk::SurfaceKHR surface_);
+    Swapchain(vk::SurfaceKHR surface_, vk::SwapchainKHR oldSwapchain=nullptr);
     ~Swapchain();
     vk::SwapchainKHR createSwapchain();
     void initFramebuffers();
@@ -40,9 +40,12 @@ public:
 
     vk::SurfaceFormatKHR getFormat() { return m_surfaceProperty.format; }
     vk::Extent2D getExtent() { return m_surfaceProperty.extent; }
+    bool supportsCapture() const { return bool(m_imageUsage & vk::ImageUsageFlagBits::eTransferSrc); }
 
 private:
     vk::SwapchainKHR     m_oldSwapchain;
+    vk::ImageUsageFlags  m_imageUsage;  /*交换链图像用途（表面支持时附加传输源，用于截图回读）*/
+    vk::DeviceSize       m_imageBytes;  /*单张交换链图像的估算大小（计入渲染目标显存统计）*/
     SurfaceInfo          m_surfaceProperty;
     SwapchainSupportInfo m_swapchainSupportInfo;
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include "vk_mem_alloc.h"
+#include "defragmenter.hpp"
+
+
+namespace vulkan2d{
+
+/*采样纹理：设备本地图像，数据上传完成后处于ShaderReadOnly布局。
+  视图覆盖全部mip层级，采样器在层级间三线性过滤*/
+struct Texture : public Relocatable{
+    vk::Image      image;
+    vk::ImageView  view;
+    vk::Sampler    sampler;
+    VmaAllocation  allocation;
+    vk::Extent3D   extent;
+    vk::Format     format;
+    uint32_t       mipLevels;          /*mip层数（多于1层时由MipmapGenerator在第0层上传后生成）*/
+    vk::DeviceSize memorySize;
+
+
+    Texture(uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, uint32_t mipLevels=1);
+    ~Texture();
+
+    void recordRelocation(vk::CommandBuffer cmdBuffer, VmaAllocation dstAllocation) override;
+    std::function<void()> commitRelocation() override;
+    void refreshAllocation() override {}
+
+private:
+    vk::ImageUsageFlags m_usage;
+    vk::Image           m_relocatedImage;   /*碎片整理时在新位置重建的图像*/
+
+    vk::Image createImage();
+    vk::ImageView createView(vk::Image image);
+    vk::Sampler createSampler();
+
+};
+
+
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <limits>
+
+#include "vulkan/vulkan.hpp"
+
+
+namespace vulkan2d{
+
+/*队列时间线：每个队列一个单调递增的timeline semaphore，
+  该队列上的每次提交发出一个新值，CPU通过比较计数值判断任意提交是否完成，无需重置fence*/
+class Timeline{
+public:
+    Timeline();
+    ~Timeline();
+
+    vk::Semaphore getHandle() const { return m_semaphore; }
+    uint64_t reserve() { return ++m_lastValue; }            /*分配下一次提交要发出的值（必须按分配顺序提交）*/
+    uint64_t getLastValue() const { return m_lastValue; }   /*最近一次分配的值*/
+    uint64_t getCompletedValue();
+    bool isComplete(uint64_t value);
+    bool wait(uint64_t value, uint64_t timeout=std::numeric_limits<uint64_t>::max());
+
+private:
+    vk::Semaphore m_semaphore;
+    uint64_t      m_lastValue;
+    uint64_t      m_completedValue;     /*缓存的已完成计数值，避免每次查询都访问驱动*/
+
+};
+
+
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <functional>
+
+#include "vulkan/vulkan.hpp"
+
+
+namespace vulkan2d{
+
+/*上传优先级：数值越大越先上传*/
+enum class UploadPriority{
+    eLow = 0,
+    eNormal = 1,
+    eHigh = 2,
+    eImmediate = 3,     /*当帧必须可用（不受预算限制）*/
+};
+
+/*上传调度：运行期间请求的缓冲/图像上传先排队（保存数据副本），每帧按优先级取出，
+  最多花费给定的字节数和CPU时间写入暂存环，大纹理按行拆分到多帧，避免一次性加载大量资源时卡顿*/
+class UploadScheduler{
+public:
+    using Ticket = uint64_t;
+
+    UploadScheduler(vk::DeviceSize bytesPerFrame=4*1024*1024, double millisecondsPerFrame=2.0);
+    ~UploadScheduler();
+
+    Ticket scheduleBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size,
+                          UploadPriority priority=UploadPriority::eNormal, std::function<void()> onComplete=nullptr);
+    Ticket scheduleImage(vk::Image dst, uint32_t width, uint32_t height, const void* data, vk::DeviceSize size,
+                         UploadPriority priority=UploadPriority::eNormal, std::function<void()> onComplete=nullptr);
+    bool cancel(Ticket ticket);
+    bool cancel(vk::Buffer dst);
+    bool cancel(vk::Image dst);
+    void retarget(vk::Buffer oldDst, vk::Buffer newDst);
+    void retarget(vk::Image oldDst, vk::Image newDst);
+    void update();
+
+    bool isPending(Ticket ticket) const;
+    bool empty() const { return m_pendingBytes==0; }
+    vk::DeviceSize getPendingBytes() const { return m_pendingBytes; }
+    vk::DeviceSize getUploadedBytes() const { return m_uploadedBytes; }     /*上一帧上传的字节数*/
+    void setBudget(vk::DeviceSize bytesPerFrame, double millisecondsPerFrame);
+
+private:
+    struct Request{
+        Ticket                ticket;
+        vk::Buffer            buffer;         /*目的缓冲（图像上传时为空）*/
+        vk::DeviceSize        dstOffset;
+        vk::Image             image;          /*目的图像（缓冲上传时为空）*/
+        uint32_t              width;
+        uint32_t              height;
+        vk::DeviceSize        rowPitch;
+        std::vector<char>     data;           /*数据副本，调用者可立即释放原数据*/
+        vk::DeviceSize        uploaded;       /*已写入暂存环的字节数（图像按整行推进）*/
+        std::function<void()> onComplete;     /*最后一块写入暂存环后调用，之后提交的帧可以使用该资源*/
+    };
+
+    std::map<UploadPriority, std::deque<Request>, std::greater<UploadPriority>> m_queues;
+    vk::DeviceSize m_bytesPerFrame;
+    double         m_millisecondsPerFrame;
+    vk::DeviceSize m_pendingBytes;
+    vk::DeviceSize m_uploadedBytes;
+    Ticket         m_nextTicket;
+
+    Ticket enqueue(Request&& request, UploadPriority priority);
+    bool cancelIf(const std::function<bool(const Request&)>& match);
+    vk::DeviceSize uploadChunk(Request& request, vk::DeviceSize budget);
+
+};
+
+
+
+}
@@ -7,6 +7,7 @@
 #include <optional>
 #include <functional>
 #include <chrono>
+#include <algorithm>
 
 #include "vulkan/vulkan.hpp"
 #define GLM_FORCE_RADIANS
@@ -25,6 +26,23 @@
 #include "myMath.hpp"
 #include "buffer.hpp"
 #include "commander.hpp"
+#include "memory_allocator.hpp"
+#include "benchmark.hpp"
+#include "ring_buffer.hpp"
+#include "staging_belt.hpp"
+#include "upload_scheduler.hpp"
+#include "readback.hpp"
+#include "sprite_batch.hpp"
+#include "sprite_scene.hpp"
+#include "deletion_queue.hpp"
+#include "defragmenter.hpp"
+#include "texture.hpp"
+#include "mipmap_generator.hpp"
+#include "gpu_vector.hpp"
+#include "timeline.hpp"
+#include "resource_tracker.hpp"
+#include "object_pool.hpp"
+#include "parallel_recorder.hpp"
 
 namespace vulkan2d{
 
@@ -36,10 +54,18 @@ struct UniformBufferObject{
     glm::mat4 proj;
 };
 
+/*顶点拉取模式的push constant：顶点着色器按设备地址读取顶点数据*/
+struct VertexPullConstants{
+    vk::DeviceAddress vertices;     /*顶点数据的设备地址*/
+    uint32_t          stride;       /*每个顶点占用的float数量*/
+    uint32_t          colorOffset;  /*颜色属性在顶点中的float偏移（位置属性偏移为0）*/
+};
+
 struct QueueFamilyIndex{
         std::optional<uint32_t> graphicsIndex;
         std::optional<uint32_t> presentIndex;
-        std::optional<uint32_t> computeIndex;
+        std::optional<uint32_t> computeIndex;   /*优先不含图形能力的异步计算队列族*/
+        std::optional<uint32_t> transferIndex;  /*优先仅含传输能力的专用传输队列族（DMA）*/
 };
 
 class VkBase{
@@ -53,14 +79,39 @@ public:
     vk::Queue                            graphicsQueue;
     vk::Queue                            presentQueue;
     vk::Queue                            computeQueue;
+    vk::Queue                            transferQueue;
     QueueFamilyIndex                     queueFamilyIndex;
+    bool                                 memoryBudgetSupported;
+    bool                                 bufferDeviceAddressSupported;
+    bool                                 drawIndirectCountSupported;
+    std::unique_ptr<MemoryAllocator>     allocator;
+    std::unique_ptr<DeletionQueue>       deletionQueue;
+    std::unique_ptr<Defragmenter>        defragmenter;
     std::unique_ptr<Swapchain>           swapchain;
     std::unique_ptr<Shader>              shader;
+    std::unique_ptr<Shader>              pullShader;     /*顶点拉取模式的着色器（不支持buffer device address时为空）*/
+    std::unique_ptr<Shader>              spriteShader;   /*精灵批处理着色器*/
+    std::unique_ptr<Shader>              spriteInstancedShader;  /*实例化精灵着色器*/
     std::unique_ptr<RenderProcess>       renderProcess;
-    std::unique_ptr<Buffer>              vertexBuffer;
-    std::unique_ptr<Buffer>              indexBuffer;
-    std::vector<std::unique_ptr<Buffer>> uniformBuffers;
-    std::unique_ptr<CommandManager>      commandManager;
+    std::unique_ptr<GpuVector<Vertex>>   vertexBuffer;
+    std::unique_ptr<GpuVector<uint16_t>> indexBuffer;
+    std::unique_ptr<Texture>             texture;
+    std::unique_ptr<MipmapGenerator>     mipmapGenerator;    /*纹理第0层上传后在图形队列上生成mip链*/
+    std::unique_ptr<RingBuffer>          uniformRing;
+    std::unique_ptr<StagingBelt>         stagingBelt;
+    std::unique_ptr<UploadScheduler>     uploadScheduler;    /*按优先级和每帧预算分摊运行期上传*/
+    std::unique_ptr<Readback>            readback;           /*随帧提交的异步GPU回读*/
+    std::unique_ptr<SpriteBatch>         spriteBatch;        /*每帧重新填充的精灵批处理*/
+    std::unique_ptr<SpriteScene>         spriteScene;        /*GPU剔除、间接绘制的常驻精灵（设备不支持多重间接绘制时为空）*/
+    std::unique_ptr<SpriteBenchmark>     spriteBenchmark;    /*精灵吞吐量测试场景（仅VULKAN2D_BENCHMARK）*/
+    std::unique_ptr<Timeline>            graphicsTimeline;   /*图形队列时间线（渲染帧与图形队列上的传输批次共用）*/
+    std::unique_ptr<Timeline>            transferTimeline;   /*专用传输队列时间线（没有专用传输队列族时为空）*/
+    std::unique_ptr<ResourceTracker>     resourceTracker;    /*图形队列上的图像/缓冲状态跟踪与屏障生成*/
+    std::unique_ptr<SyncPool>            syncPool;           /*主线程的信号量复用池*/
+    std::unique_ptr<CommandManager>      commandManager;     /*主线程按帧复用的图形命令缓冲*/
+    std::unique_ptr<ParallelRecorder>    parallelRecorder;   /*录制线程（各自的命令管理器）并行录制渲染流程内的辅助命令缓冲*/
+    std::unique_ptr<Commander>           commander;      /*图形队列上的传输命令批处理提交*/
+    std::unique_ptr<Commander>           transferCommander;  /*专用传输队列上的批处理提交（没有专用传输队列族时为空）*/
     std::unique_ptr<DescriptorManager>   descriptorManager;
     std::unique_ptr<Renderer>            renderer;
 
@@ -69,22 +120,36 @@ public:
     static void destroy();
 
     vk::DispatchLoaderDynamic loadInstanceDynamicLoader();
+    void initMemoryAllocator();
+    void initDeletionQueue();
+    void initDefragmenter();
     void initSwapchain();
     void initShaderModules(const std::string& vertexFile, const std::string& fragmentFile);
+    void initVertexPullingShader(const std::string& vertexFile, const std::string& fragmentFile);
+    void initSpriteShader(const std::string& vertexFile, const std::string& instancedVertexFile, const std::string& fragmentFile);
     void initRenderProcess();
     void initPipeline();
+    void initTimelines();
+    void initResourceTracker();
+    void initSyncPool();
     void initCommandManager();
+    void initParallelRecorder();
+    void initCommander();
     void initDescriptorManager();
+    void initMipmapGenerator(const std::string& computeFile);
+    void initStagingBelt();
+    void initUploadScheduler();
+    void initReadback();
     void initVertexBuffer();
     void initIndexBuffer();
+    void initSpriteBatch();
+    void initSpriteScene(const std::string& cullFile);
     void initUniformBuffers();
-    void updateUniformBuffers(int currentFrame);
+    uint32_t updateUniformBuffers();
     void initRenderer();
     void recreateSwapchain();
 
     void createTextureImage();
-    vk::Image textureImage;
-    vk::DeviceMemory textureImageMemory;
 
 
 private:
@@ -106,8 +171,9 @@ private:
     vk::Instance createInstance();
     vk::DebugUtilsMessengerEXT createDebugMessenger();
     vk::PhysicalDevice pickPhysicalDevice();
-    struct QueueFamilyIndex queryQueueFamilyIndex(bool enableGraphicsQueue=true, bool enablePresentQueue=true, bool enableComputQueue=false);
+    struct QueueFamilyIndex queryQueueFamilyIndex();
     vk::Device createLogicalDevice();
+    bool isDeviceExtensionSupported(const char* extensionName);
 
 };
 
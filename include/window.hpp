@@ -8,6 +8,7 @@ extern const int HEIGHT;
 extern const char* TITLE;
 
 void windowResizedCallback(GLFWwindow* window, int width, int height);
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 class Window{
 public:
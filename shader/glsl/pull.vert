@@ -0,0 +1,31 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexData{
+    float values[];
+};
+
+layout(push_constant) uniform PushConstants{
+    VertexData vertices;
+    uint       stride;
+    uint       colorOffset;
+}pc;
+
+layout(location = 0) out vec3 fragColor;
+
+layout(binding = 0) uniform UniformBufferObject{
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+}ubo;
+
+void main()
+{
+    uint base = uint(gl_VertexIndex) * pc.stride;
+    vec2 inPosition = vec2(pc.vertices.values[base], pc.vertices.values[base+1]);
+    uint color = base + pc.colorOffset;
+    vec3 inColor = vec3(pc.vertices.values[color], pc.vertices.values[color+1], pc.vertices.values[color+2]);
+
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor;
+}
\ No newline at end of file
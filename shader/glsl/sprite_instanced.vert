@@ -0,0 +1,28 @@
+#version 450
+
+layout(location = 0) in vec2 inCorner;      /*单位四边形的角（-0.5~0.5）*/
+layout(location = 1) in vec2 inPosition;    /*以下为逐实例属性*/
+layout(location = 2) in vec2 inSize;
+layout(location = 3) in float inRotation;
+layout(location = 4) in vec4 inTexRect;
+layout(location = 5) in vec4 inColor;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject{
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+}ubo;
+
+void main()
+{
+    vec2 local = inCorner * inSize;
+    float c = cos(inRotation);
+    float s = sin(inRotation);
+    vec2 position = inPosition + vec2(c*local.x - s*local.y, s*local.x + c*local.y);
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 0.0, 1.0);
+    fragTexCoord = mix(inTexRect.xy, inTexRect.zw, inCorner + 0.5);
+    fragColor = inColor;
+}
@@ -23,11 +23,23 @@ void initial()
     };
     VkBase::init(extensions, getSurfaceCallback);
 
+    /*初始化显存分配器*/
+    VkBase::self().initMemoryAllocator();
+
+    /*初始化延迟销毁队列*/
+    VkBase::self().initDeletionQueue();
+
+    /*初始化显存碎片整理器*/
+    VkBase::self().initDefragmenter();
+
     /*初始化VkBase实例的交换链*/
     VkBase::self().initSwapchain();
 
     /*初始化着色器模组*/
     VkBase::self().initShaderModules("C:/VSCode_files/vulkan2D/shader/generated/shader.vert.spv", "C:/VSCode_files/vulkan2D/shader/generated/shader.frag.spv");
+    VkBase::self().initVertexPullingShader("C:/VSCode_files/vulkan2D/shader/generated/pull.vert.spv", "C:/VSCode_files/vulkan2D/shader/generated/shader.frag.spv");
+    VkBase::self().initSpriteShader("C:/VSCode_files/vulkan2D/shader/generated/sprite.vert.spv", "C:/VSCode_files/vulkan2D/shader/generated/sprite_instanced.vert.spv",
+                                    "C:/VSCode_files/vulkan2D/shader/generated/sprite.frag.spv");
   
     /*初始化渲染流程*/
     VkBase::self().initRenderProcess();
@@ -38,12 +50,36 @@ void initial()
     /*初始化framebuffer*/
     VkBase::self().swapchain->initFramebuffers();
 
+    /*初始化队列时间线*/
+    VkBase::self().initTimelines();
+
+    /*初始化资源状态跟踪*/
+    VkBase::self().initResourceTracker();
+
+    /*初始化同步对象复用池*/
+    VkBase::self().initSyncPool();
+
     /*初始化命令池*/
     VkBase::self().initCommandManager();
 
+    /*初始化多线程命令录制*/
+    VkBase::self().initParallelRecorder();
+
+    /*初始化传输命令批处理*/
+    VkBase::self().initCommander();
+
     /*初始化描述符集池*/
     VkBase::self().initDescriptorManager();
 
+    /*初始化mipmap生成*/
+    VkBase::self().initMipmapGenerator("C:/VSCode_files/vulkan2D/shader/generated/mipmap.comp.spv");
+
+    /*初始化暂存环*/
+    VkBase::self().initStagingBelt();
+
+    /*初始化上传调度*/
+    VkBase::self().initUploadScheduler();
+
     VkBase::self().createTextureImage();
 
     /*初始化顶点缓冲*/
@@ -52,6 +88,19 @@ void initial()
     /*初始化顶点索引缓冲*/
     VkBase::self().initIndexBuffer();
 
+    /*初始化精灵批处理（静态四边形索引随下面的暂存环一起上传）*/
+    VkBase::self().initSpriteBatch();
+
+    /*初始化GPU驱动的精灵场景*/
+    VkBase::self().initSpriteScene("C:/VSCode_files/vulkan2D/shader/generated/sprite_cull.comp.spv");
+
+    /*一次提交所有暂存上传*/
+    VkBase::self().uploadScheduler->update();
+    VkBase::self().stagingBelt->flush();
+
+    /*初始化异步回读*/
+    VkBase::self().initReadback();
+
     /*初始化uniform缓冲*/
     VkBase::self().initUniformBuffers();
 
@@ -59,8 +108,12 @@ void initial()
     VkBase::self().initRenderer();
 
     /*更新并绑定描述符缓冲*/
-    VkBase::self().renderer->updateDescriptorSets(VkBase::self().uniformBuffers);
+    VkBase::self().renderer->updateDescriptorSets(*VkBase::self().uniformRing);
 
+#ifdef VULKAN2D_BENCHMARK
+    /*显存分配吞吐量测试*/
+    benchmarkAllocation();
+#endif
 }
 
 void run()
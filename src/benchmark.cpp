@@ -0,0 +1,172 @@
+#include "benchmark.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+void benchmarkAllocation(uint32_t count, vk::DeviceSize size)
+{
+    auto& base_instance = VkBase::self();
+    using clock = std::chrono::high_resolution_clock;
+    /*单独分配的数量受maxMemoryAllocationCount限制，预留一部分给引擎自身*/
+    uint32_t maxAllocationCount = base_instance.physicalDevice.getProperties().limits.maxMemoryAllocationCount;
+    uint32_t rawCount = std::min(count, maxAllocationCount>256 ? maxAllocationCount-256 : 0u);
+
+    /*1.旧路径：每个缓冲一次vkAllocateMemory*/
+    std::vector<vk::Buffer> rawBuffers(rawCount);
+    std::vector<vk::DeviceMemory> rawMemories(rawCount);
+    auto start = clock::now();
+    for(uint32_t i=0; i<rawCount; i++)
+    {
+        vk::BufferCreateInfo createInfo = {};
+        createInfo.setUsage(vk::BufferUsageFlagBits::eVertexBuffer)
+                  .setSize(size)
+                  .setSharingMode(vk::SharingMode::eExclusive);
+        rawBuffers[i] = base_instance.device.createBuffer(createInfo);
+        vk::MemoryRequirements requirements = base_instance.device.getBufferMemoryRequirements(rawBuffers[i]);
+        vk::MemoryAllocateInfo allocateInfo = {};
+        allocateInfo.setAllocationSize(requirements.size)
+                    .setMemoryTypeIndex(findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        rawMemories[i] = base_instance.device.allocateMemory(allocateInfo);
+        base_instance.device.bindBufferMemory(rawBuffers[i], rawMemories[i], 0);
+    }
+    auto allocated = clock::now();
+    for(uint32_t i=0; i<rawCount; i++)
+    {
+        base_instance.device.destroyBuffer(rawBuffers[i]);
+        base_instance.device.freeMemory(rawMemories[i]);
+    }
+    auto freed = clock::now();
+    double rawAllocMs = std::chrono::duration<double, std::milli>(allocated-start).count();
+    double rawFreeMs = std::chrono::duration<double, std::milli>(freed-allocated).count();
+
+    /*2.新路径：Buffer从VMA内存块中子分配*/
+    std::vector<std::unique_ptr<Buffer>> buffers(count);
+    start = clock::now();
+    for(uint32_t i=0; i<count; i++)
+        buffers[i] = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eVertexBuffer, size, vk::MemoryPropertyFlagBits::eDeviceLocal);
+    allocated = clock::now();
+    MemoryStats stats = base_instance.allocator->getStats();
+    buffers.clear();
+    freed = clock::now();
+    double subAllocMs = std::chrono::duration<double, std::milli>(allocated-start).count();
+    double subFreeMs = std::chrono::duration<double, std::milli>(freed-allocated).count();
+
+    std::cout << "[ Benchmark ]: allocation of " << size << "-byte buffers" << std::endl;
+    std::cout << "    vkAllocateMemory per buffer: " << rawCount << " buffers, alloc " << rawAllocMs << " ms, free " << rawFreeMs << " ms, "
+              << (rawAllocMs>0.0 ? rawCount/rawAllocMs*1000.0 : 0.0) << " allocs/s" << std::endl;
+    std::cout << "    sub-allocation (VMA):        " << count << " buffers, alloc " << subAllocMs << " ms, free " << subFreeMs << " ms, "
+              << (subAllocMs>0.0 ? count/subAllocMs*1000.0 : 0.0) << " allocs/s, " << stats.blockCount << " blocks" << std::endl;
+}
+
+SpriteBenchmark::SpriteBenchmark(uint32_t count)
+    : m_particles(count), m_cpuMs(0.0), m_frames(0), m_gpuDriven(false)
+{
+    /*固定种子的线性同余序列，保证每次运行的场景相同*/
+    uint32_t seed = 12345u;
+    auto random = [&seed]()
+    {
+        seed = seed*1664525u + 1013904223u;
+        return (seed>>8) / 16777216.0f;
+    };
+    vk::Extent2D extent = VkBase::self().swapchain->getExtent();
+    for(auto& particle : m_particles)
+    {
+        particle.position = glm::vec2(random()*extent.width, random()*extent.height);
+        float angle = random() * 6.2831853f;
+        float speed = 40.0f + random()*160.0f;
+        particle.velocity = glm::vec2(std::cos(angle), std::sin(angle)) * speed;
+        particle.rotation = random() * 6.2831853f;
+        particle.spin = (random()-0.5f) * 4.0f;
+        particle.color = packColor(glm::vec4(0.5f+0.5f*random(), 0.5f+0.5f*random(), 0.5f+0.5f*random(), 0.8f));
+    }
+    m_lastTime = std::chrono::high_resolution_clock::now();
+    m_reportTime = m_lastTime;
+}
+
+void SpriteBenchmark::setGpuDriven(bool gpuDriven)
+{
+    auto& base_instance = VkBase::self();
+    if(!base_instance.spriteScene || gpuDriven==m_gpuDriven)
+        return;
+    m_gpuDriven = gpuDriven;
+    SpriteScene& scene = *base_instance.spriteScene;
+    scene.clear();
+    if(!m_gpuDriven)
+        return;
+    /*对象一次性写入场景，之后每帧只有GPU剔除和一次间接绘制*/
+    scene.setTexture(*base_instance.texture, BlendMode::eAdditive);
+    Sprite sprite = {};
+    sprite.size = glm::vec2(8.0f, 8.0f);
+    for(auto& particle : m_particles)
+    {
+        sprite.position = particle.position;
+        sprite.rotation = particle.rotation;
+        sprite.color = particle.color;
+        scene.add(sprite);
+    }
+}
+
+void SpriteBenchmark::update(SpriteBatch& batch, const Texture& texture)
+{
+    using clock = std::chrono::high_resolution_clock;
+    auto start = clock::now();
+    float dt = std::min(std::chrono::duration<float>(start-m_lastTime).count(), 0.1f);
+    m_lastTime = start;
+
+    /*1.移动粒子，碰到窗口边缘时反弹（GPU驱动模式下跳过）*/
+    vk::Extent2D extent = VkBase::self().swapchain->getExtent();
+    glm::vec2 bounds(static_cast<float>(extent.width), static_cast<float>(extent.height));
+    Sprite sprite = {};
+    sprite.size = glm::vec2(8.0f, 8.0f);
+    if(!m_gpuDriven)
+    {
+        for(auto& particle : m_particles)
+        {
+            particle.position += particle.velocity * dt;
+            particle.rotation += particle.spin * dt;
+            for(int axis=0; axis<2; axis++)
+            {
+                if(particle.position[axis]<0.0f)
+                {
+                    particle.position[axis] = -particle.position[axis];
+                    particle.velocity[axis] = std::abs(particle.velocity[axis]);
+                }
+                else if(particle.position[axis]>bounds[axis])
+                {
+                    particle.position[axis] = 2.0f*bounds[axis] - particle.position[axis];
+                    particle.velocity[axis] = -std::abs(particle.velocity[axis]);
+                }
+            }
+            /*2.提交精灵（超出批处理容量的部分不绘制）*/
+            if(batch.getSpriteCount()>=batch.getMaxSprites())
+                continue;
+            sprite.position = particle.position;
+            sprite.rotation = particle.rotation;
+            sprite.color = particle.color;
+            batch.draw(texture, sprite, BlendMode::eAdditive);
+        }
+    }
+
+    /*3.每秒输出一次统计*/
+    auto finish = clock::now();
+    m_cpuMs += std::chrono::duration<double, std::milli>(finish-start).count();
+    m_frames++;
+    double elapsed = std::chrono::duration<double>(finish-m_reportTime).count();
+    if(elapsed>=1.0)
+    {
+        if(m_gpuDriven)
+            std::cout << "[ Benchmark ]: gpu-driven objects " << VkBase::self().spriteScene->getObjectCount()
+                      << (VkBase::self().spriteScene->usesDrawCount() ? ", drawIndexedIndirectCount" : ", drawIndexedIndirect");
+        else
+            std::cout << "[ Benchmark ]: " << (batch.getMode()==SpriteMode::eInstanced ? "instanced" : "expanded") << " sprites " << batch.getSpriteCount() << ", draws " << batch.getDrawCount();
+        std::cout << ", " << m_frames/elapsed << " fps, CPU " << m_cpuMs/m_frames << " ms/frame" << std::endl;
+        m_cpuMs = 0.0;
+        m_frames = 0;
+        m_reportTime = finish;
+    }
+}
+
+
+
+}
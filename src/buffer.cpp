@@ -4,55 +4,176 @@
 namespace vulkan2d{
 
 Buffer::Buffer(vk::BufferUsageFlags usage, size_t size, vk::MemoryPropertyFlags properties)
+{
+    /*显式指定内存属性：使用第一个满足属性要求的内存类型*/
+    createBuffer(usage, size);
+    auto& allocator = *VkBase::self().allocator;
+    uint32_t typeBits = VkBase::self().device.getBufferMemoryRequirements(buffer).memoryTypeBits;
+    allocateMemory(allocator.filterMemoryTypes(typeBits, properties));
+}   
+
+Buffer::Buffer(vk::BufferUsageFlags usage, size_t size, MemoryUsage memoryUsage)
+{
+    /*按用途选择内存类型：按得分依次尝试候选类型*/
+    if(memoryUsage==MemoryUsage::eGpuOnly)
+        usage |= vk::BufferUsageFlagBits::eTransferSrc|vk::BufferUsageFlagBits::eTransferDst;   /*允许碎片整理时拷贝移动*/
+    createBuffer(usage, size);
+    auto& allocator = *VkBase::self().allocator;
+    uint32_t typeBits = VkBase::self().device.getBufferMemoryRequirements(buffer).memoryTypeBits;
+    allocateMemory(allocator.rankMemoryTypes(typeBits, memoryUsage));
+}
+
+Buffer::~Buffer()
 {
     auto& base_instance = VkBase::self();
+    base_instance.allocator->untrack(category, memorySize);
+    base_instance.allocator->dropRanges(allocation);
+    if(base_instance.uploadScheduler)
+        base_instance.uploadScheduler->cancel(buffer);
+    /*正在被碎片整理移动的分配由VMA在pass结束时释放，这里只销毁缓冲对象*/
+    if(base_instance.defragmenter && base_instance.defragmenter->release(allocation))
+        base_instance.device.destroyBuffer(buffer);
+    else
+        vmaDestroyBuffer(base_instance.allocator->getHandle(), static_cast<VkBuffer>(buffer), allocation);
+}
+
+void Buffer::flush(vk::DeviceSize offset, vk::DeviceSize size)
+{
+    /*非一致内存：CPU写入的区间记录下来，提交前由分配器统一flush*/
+    if(isCoherent())
+        return;
+    if(size==VK_WHOLE_SIZE)
+        size = this->size - offset;
+    VkBase::self().allocator->queueFlush(allocation, offset, size);
+}
+
+void Buffer::invalidate(vk::DeviceSize offset, vk::DeviceSize size)
+{
+    /*非一致内存：GPU写入的区间记录下来，帧完成后由分配器统一invalidate*/
+    if(isCoherent())
+        return;
+    if(size==VK_WHOLE_SIZE)
+        size = this->size - offset;
+    VkBase::self().allocator->queueInvalidate(allocation, offset, size);
+}
+
+void Buffer::createBuffer(vk::BufferUsageFlags usage, size_t size)
+{
     /*1.创建内存缓冲*/
     this->size = size;
+    this->usage = usage;
+    m_relocatedBuffer = nullptr;
+    category = categorizeBuffer(usage);
     vk::BufferCreateInfo createInfo = {};
     createInfo.setUsage(usage)                              /*内存缓冲用途*/
               .setSize(size)                                /*内存缓冲大小（字节）*/
               .setSharingMode(vk::SharingMode::eExclusive); /*共享模式：独有*/
-    buffer = base_instance.device.createBuffer(createInfo);
+    buffer = VkBase::self().device.createBuffer(createInfo);
     if(!buffer)
         throw std::runtime_error("[ Buffer ]: Can't create  vulkan buffer!");
-    /*2.获取内存需求*/
-    vk::MemoryRequirements requirements = base_instance.device.getBufferMemoryRequirements(buffer);
-    memorySize = requirements.size;
-    /*3.分配内存*/
-    uint32_t typeIndex = findMemoryType(requirements.memoryTypeBits, properties);
-    vk::MemoryAllocateInfo allocateInfo = {};
-    allocateInfo.setAllocationSize(requirements.size)
-                .setMemoryTypeIndex(typeIndex);
-    memory = base_instance.device.allocateMemory(allocateInfo);
-    if(!memory)
-        throw std::runtime_error("[ Buffer ]: Can't allocate memory!");     
-    /*4.绑定内存和缓冲对象*/
-    base_instance.device.bindBufferMemory(buffer, memory, 0);
-    /*5.内存映射*/
-    if(properties & vk::MemoryPropertyFlagBits::eHostVisible)
-        data = base_instance.device.mapMemory(memory, 0, size);
-    else
-        data = nullptr;        
-}   
+}
 
-Buffer::~Buffer()
+void Buffer::allocateMemory(const std::vector<uint32_t>& candidates)
 {
-    auto& base_instance = VkBase::self();
-    
-    base_instance.device.freeMemory(memory);
-    base_instance.device.destroyBuffer(buffer);
+    /*2.从VMA内存块中分配内存并绑定（主机可见内存持久映射）*/
+    VmaAllocationInfo allocInfo = {};
+    try
+    {
+        allocation = VkBase::self().allocator->allocateBuffer(buffer, candidates, allocInfo);
+    }
+    catch(const std::exception&)
+    {
+        VkBase::self().device.destroyBuffer(buffer);
+        throw;
+    }
+    memory = allocInfo.deviceMemory;
+    offset = allocInfo.offset;
+    memorySize = allocInfo.size;
+    memoryType = allocInfo.memoryType;
+    memoryProperties = VkBase::self().allocator->getMemoryProperties().memoryTypes[memoryType].propertyFlags;
+    /*3.内存映射*/
+    data = allocInfo.pMappedData;
+    address = queryAddress();
+    /*4.计入对应子系统的显存统计*/
+    VkBase::self().allocator->track(category, memorySize);
+    /*5.仅GPU可见且可拷贝的缓冲允许碎片整理移动*/
+    if(!(memoryProperties & vk::MemoryPropertyFlagBits::eHostVisible)
+       && (usage & vk::BufferUsageFlagBits::eTransferSrc) && (usage & vk::BufferUsageFlagBits::eTransferDst))
+        vmaSetAllocationUserData(VkBase::self().allocator->getHandle(), allocation, static_cast<Relocatable*>(this));
+}
+
+void Buffer::recordRelocation(vk::CommandBuffer cmdBuffer, VmaAllocation dstAllocation)
+{
+    /*1.以相同参数重建缓冲并绑定到目标内存*/
+    vk::BufferCreateInfo createInfo = {};
+    createInfo.setUsage(usage)
+              .setSize(size)
+              .setSharingMode(vk::SharingMode::eExclusive);
+    m_relocatedBuffer = VkBase::self().device.createBuffer(createInfo);
+    if(vmaBindBufferMemory(VkBase::self().allocator->getHandle(), dstAllocation, static_cast<VkBuffer>(m_relocatedBuffer))!=VK_SUCCESS)
+        throw std::runtime_error("[ Buffer ]: Can't bind relocated buffer memory!");
+    /*2.旧缓冲最近由之前提交的传输写入（暂存环或同步拷贝，不在跟踪的录制顺序中），拷贝前使其对传输读取可见*/
+    auto& tracker = *VkBase::self().resourceTracker;
+    tracker.assume(buffer, ResourceUse::eTransferDst);
+    tracker.useBuffer(buffer, ResourceUse::eTransferSrc);
+    tracker.flush(cmdBuffer);
+    /*3.记录旧缓冲到新缓冲的拷贝*/
+    vk::BufferCopy region = {};
+    region.setSrcOffset(0)
+          .setDstOffset(0)
+          .setSize(size);
+    cmdBuffer.copyBuffer(buffer, m_relocatedBuffer, region);
+}
+
+std::function<void()> Buffer::commitRelocation()
+{
+    /*后续录制的命令使用新缓冲，旧缓冲交由延迟销毁队列在其引用帧完成后销毁*/
+    vk::Buffer oldBuffer = buffer;
+    buffer = m_relocatedBuffer;
+    m_relocatedBuffer = nullptr;
+    address = queryAddress();
+    VkBase::self().resourceTracker->forget(oldBuffer);
+    VkBase::self().uploadScheduler->retarget(oldBuffer, buffer);
+    return [oldBuffer](){ VkBase::self().device.destroyBuffer(oldBuffer); };
+}
+
+void Buffer::refreshAllocation()
+{
+    VmaAllocationInfo allocInfo = {};
+    vmaGetAllocationInfo(VkBase::self().allocator->getHandle(), allocation, &allocInfo);
+    memory = allocInfo.deviceMemory;
+    offset = allocInfo.offset;
+    data = allocInfo.pMappedData;
+}
+
+vk::DeviceAddress Buffer::queryAddress() const
+{
+    if(!(usage & vk::BufferUsageFlagBits::eShaderDeviceAddress))
+        return 0;
+    vk::BufferDeviceAddressInfo addressInfo = {};
+    addressInfo.setBuffer(buffer);
+    return VkBase::self().device.getBufferAddress(addressInfo);
 }
 
 uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
 {
-    vk::PhysicalDeviceMemoryProperties supportProperties = VkBase::self().physicalDevice.getMemoryProperties();
-    for(uint32_t i=0; i<supportProperties.memoryTypeCount; i++)
-    {
-        if(typeFilter&(1<<i) && (supportProperties.memoryTypes[i].propertyFlags&properties)==properties)
-            return i;
-    }
-    throw std::runtime_error("[ Buffer ]: Can't find the support memoryType!");
-    return 0;
+    std::vector<uint32_t> candidates = VkBase::self().allocator->filterMemoryTypes(typeFilter, properties);
+    if(candidates.empty())
+        throw std::runtime_error("[ Buffer ]: Can't find the support memoryType!");
+    return candidates[0];
 }
 
-}
\ No newline at end of file
+MemoryCategory categorizeBuffer(vk::BufferUsageFlags usage)
+{
+    if(usage & vk::BufferUsageFlagBits::eVertexBuffer)
+        return MemoryCategory::eVertex;
+    if(usage & vk::BufferUsageFlagBits::eIndexBuffer)
+        return MemoryCategory::eIndex;
+    if(usage & vk::BufferUsageFlagBits::eUniformBuffer)
+        return MemoryCategory::eUniform;
+    if(usage == vk::BufferUsageFlags(vk::BufferUsageFlagBits::eTransferSrc))
+        return MemoryCategory::eStaging;
+    return MemoryCategory::eOther;
+}
+
+}
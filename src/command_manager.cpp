@@ -4,43 +4,61 @@
 
 namespace vulkan2d{
 
-CommandManager::CommandManager()
+CommandManager::CommandManager(uint32_t queueFamily) : m_queueFamily(queueFamily), m_current(0)
 {
-    m_pool = createCommandPool();
 }
 
 CommandManager::~CommandManager()
 {
-    VkBase::self().device.destroyCommandPool(m_pool);
+    /*命令缓冲随命令池一起释放*/
+    for(auto& frame : m_frames)
+        VkBase::self().device.destroyCommandPool(frame.pool);
 }
 
-std::vector<vk::CommandBuffer> CommandManager::allocateCommandBuffers(uint32_t count)
+void CommandManager::beginFrame(uint32_t slot)
 {
-    vk::CommandBufferAllocateInfo allocateInfo = {};
-    allocateInfo.setCommandBufferCount(count)           
-                .setCommandPool(m_pool)
-                .setLevel(vk::CommandBufferLevel::ePrimary);    /*设置命令缓冲等级为主命令缓冲，可直接提交至队列执行*/
-    return VkBase::self().device.allocateCommandBuffers(allocateInfo);
+    /*调用前该槽位上一次提交的帧已完成：整池复位，池中的命令缓冲全部回到初始状态*/
+    while(m_frames.size()<=slot)
+        m_frames.push_back(FramePool{createCommandPool(), {}, {}, 0, 0});
+    m_current = slot;
+    FramePool& frame = m_frames[m_current];
+    VkBase::self().device.resetCommandPool(frame.pool);
+    frame.usedPrimary = 0;
+    frame.usedSecondary = 0;
 }
 
-void CommandManager::freeCommandBuffers()
+vk::CommandBuffer CommandManager::allocateCommandBuffer(vk::CommandBufferLevel level)
 {
-    auto& base_instance = VkBase::self();
-
-    base_instance.device.freeCommandBuffers(m_pool, base_instance.renderer->getCommandBuffers());
+    if(m_frames.empty())
+        beginFrame(0);
+    FramePool& frame = m_frames[m_current];
+    bool primary = (level==vk::CommandBufferLevel::ePrimary);
+    auto& buffers = primary ? frame.primary : frame.secondary;
+    size_t& used = primary ? frame.usedPrimary : frame.usedSecondary;
+    /*复用池中已有的命令缓冲，不足时才分配*/
+    if(used==buffers.size())
+    {
+        vk::CommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.setCommandBufferCount(1)           
+                    .setCommandPool(frame.pool)
+                    .setLevel(level);   /*主命令缓冲可直接提交至队列执行，辅助命令缓冲由主命令缓冲调用*/
+        buffers.push_back(VkBase::self().device.allocateCommandBuffers(allocateInfo)[0]);
+        objectCounters().commandBuffers++;
+    }
+    return buffers[used++];
 }
 
 
 vk::CommandPool CommandManager::createCommandPool()
 {
     vk::CommandPoolCreateInfo createInfo = {};
-    createInfo.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
-              .setQueueFamilyIndex(VkBase::self().queueFamilyIndex.graphicsIndex.value());  /*设置命令缓冲提交到的队列索引*/
-
+    createInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient)   /*命令缓冲生命周期短，整池复位*/
+              .setQueueFamilyIndex(m_queueFamily);                    /*设置命令缓冲提交到的队列索引*/
+    objectCounters().commandPools++;
     return VkBase::self().device.createCommandPool(createInfo);
 }
 
 
 
 
-}
\ No newline at end of file
+}
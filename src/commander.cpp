@@ -4,151 +4,240 @@
 
 namespace vulkan2d{
 
-Commander::Commander()
-{
-    /*0.创建fence同步cpu与Gpu*/
-    vk::FenceCreateInfo fenceCreateInfo = {};
-    m_fence = VkBase::self().device.createFence(fenceCreateInfo);
-    /*1.创建临时用于转移数据的command pool(使用与图形命令队列)*/
-    vk::CommandPoolCreateInfo cmdPoolCreateInfo = {};
-    cmdPoolCreateInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient|vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
-                     .setQueueFamilyIndex(VkBase::self().queueFamilyIndex.graphicsIndex.value());  
-    m_pool = VkBase::self().device.createCommandPool(cmdPoolCreateInfo);
-    /*2.分配命令缓冲*/
-    vk::CommandBufferAllocateInfo allocateInfo = {};
-    allocateInfo.setCommandBufferCount(1)           
-                .setCommandPool(m_pool)
-                .setLevel(vk::CommandBufferLevel::ePrimary);    /*设置命令缓冲等级为主命令缓冲，可直接提交至队列执行*/
-    m_cmdBuffer = VkBase::self().device.allocateCommandBuffers(allocateInfo)[0];
+Commander::Commander(uint32_t queueFamily, vk::Queue queue, Timeline& timeline)
+    : m_queueFamily(queueFamily), m_queue(queue), m_timeline(timeline), m_batchPool(nullptr), m_cmdBuffer(nullptr), m_submitCount(0)
+{
+    m_crossQueue = (m_queueFamily!=VkBase::self().queueFamilyIndex.graphicsIndex.value());
 }
 
 Commander::~Commander()
 {
-    /*清除栅栏和命令池*/
-    VkBase::self().device.destroyFence(m_fence);
-    VkBase::self().device.freeCommandBuffers(m_pool, m_cmdBuffer);
-    VkBase::self().device.destroyCommandPool(m_pool);
+    /*等待所有批次完成后清除命令池（命令缓冲随命令池一起释放）*/
+    if(!m_inflight.empty())
+        wait(CommandToken{m_inflight.back().token});
+    for(auto& pool : m_pools)
+        VkBase::self().device.destroyCommandPool(pool);
 }
 
 void Commander::copyBuffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size)
 {
-    /*1.记录命令*/
-    beginSingleTimeCommands();
-        vk::BufferCopy copyRegion = {}; /*设置复制缓冲的区域*/
-        copyRegion.setSrcOffset(0)      /*源缓冲待复制的起始位置*/
-                  .setDstOffset(0)      /*目的缓冲待复制的起始位置*/
-                  .setSize(size);       /*复制缓冲区域的大小*/
-        m_cmdBuffer.copyBuffer(src, dst, copyRegion); /*执行拷贝内存操作*/
-    endSingleTimeCommands();
-
-    /*2.提交命令*/
-    submit();
-
-    /*3.复位栅栏并重置命令缓冲*/
-    VkBase::self().device.resetFences(m_fence);
-    m_cmdBuffer.reset();
+    vk::BufferCopy copyRegion = {}; /*设置复制缓冲的区域*/
+    copyRegion.setSrcOffset(0)      /*源缓冲待复制的起始位置*/
+              .setDstOffset(0)      /*目的缓冲待复制的起始位置*/
+              .setSize(size);       /*复制缓冲区域的大小*/
+    beginBatch();
+    recordCopy(src, dst, copyRegion);
+    wait(submitBatch());
 }
 
 void Commander::copyBuffer(vk::Buffer srcBuffer, vk::Image dstImage, uint32_t width, uint32_t height)
 {
-    /*1.记录命令*/
-    beginSingleTimeCommands();
-        vk::ImageSubresourceLayers subresourceLayers;
-        subresourceLayers.setAspectMask(vk::ImageAspectFlagBits::eColor)    /*设置数据被复制的图像范围*/
-                         .setMipLevel(0)                                    /*设置子资源mipmap起始索引*/
-                         .setBaseArrayLayer(0).setLayerCount(1);            /*设置子资源纹理数组起始索引与数组数量*/
-        vk::BufferImageCopy copyRegion = {};
-        copyRegion.setBufferOffset(0)                               /*设置内存缓冲偏移*/
-                  .setBufferRowLength(0)                            /*设置内存数据对齐方式：紧凑对齐*/
-                  .setBufferImageHeight(0)                          /*同上*/
-                  .setImageSubresource(subresourceLayers)           /*设置图像子资源*/
-                  .setImageOffset(vk::Offset3D{0, 0, 0})            /*设置数据被复制到图像对象的偏移量*/
-                  .setImageExtent(vk::Extent3D{width, height, 1});  /*设置数据被复制到图像对象的区域*/
-        m_cmdBuffer.copyBufferToImage(srcBuffer, dstImage, vk::ImageLayout::eTransferDstOptimal, copyRegion);
-    endSingleTimeCommands();
-
-    /*2.提交命令*/
-    submit();
+    vk::ImageSubresourceLayers subresourceLayers;
+    subresourceLayers.setAspectMask(vk::ImageAspectFlagBits::eColor)    /*设置数据被复制的图像范围*/
+                     .setMipLevel(0)                                    /*设置子资源mipmap起始索引*/
+                     .setBaseArrayLayer(0).setLayerCount(1);            /*设置子资源纹理数组起始索引与数组数量*/
+    vk::BufferImageCopy copyRegion = {};
+    copyRegion.setBufferOffset(0)                               /*设置内存缓冲偏移*/
+              .setBufferRowLength(0)                            /*设置内存数据对齐方式：紧凑对齐*/
+              .setBufferImageHeight(0)                          /*同上*/
+              .setImageSubresource(subresourceLayers)           /*设置图像子资源*/
+              .setImageOffset(vk::Offset3D{0, 0, 0})            /*设置数据被复制到图像对象的偏移量*/
+              .setImageExtent(vk::Extent3D{width, height, 1});  /*设置数据被复制到图像对象的区域*/
+    beginBatch();
+    recordCopy(srcBuffer, dstImage, copyRegion);
+    wait(submitBatch());
+}
 
-    /*3.复位栅栏并重置命令缓冲*/
-    VkBase::self().device.resetFences(m_fence);
-    m_cmdBuffer.reset();
+void Commander::transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+{
+    beginBatch();
+    recordLayoutTransition(image, oldLayout, newLayout);
+    wait(submitBatch());
 }
 
+void Commander::execute(const std::function<void(vk::CommandBuffer)>& record)
+{
+    wait(submitAsync(record));
+}
 
-void Commander::transitionImageLayout(vk::Image image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+void Commander::beginBatch()
 {
-    /*0.设置屏障依赖条件(操作类型依赖/管线阶段依赖)*/
-    vk::PipelineStageFlags srcStage, dstStage;
-    vk::AccessFlags srcAccess, dstAccess;
-    if(oldLayout==vk::ImageLayout::eUndefined && newLayout==vk::ImageLayout::eTransferDstOptimal)
+    if(m_cmdBuffer)
+        return;     /*已在录制中：继续追加到当前批次*/
+    /*1.复用已完成批次的命令池和命令缓冲，没有则新建（稳态下不再创建）*/
+    collect();
+    if(!m_free.empty())
     {
-        srcAccess = vk::AccessFlagBits::eNone;              /*将布局变换为传输布局不需要等待任何操作*/
-        dstAccess = vk::AccessFlagBits::eTransferWrite;     /*后续传输操作需要等待该函数布局转换完成*/
-        srcStage = vk::PipelineStageFlagBits::eTopOfPipe;   /*屏障需要依赖的前置shader阶段*/
-        dstStage = vk::PipelineStageFlagBits::eTransfer;    /*后续管线阶段需要等待该函数布局转换完成*/
+        m_batchPool = m_free.back().pool;
+        m_cmdBuffer = m_free.back().cmdBuffer;
+        m_free.pop_back();
     }
-    else if(oldLayout==vk::ImageLayout::eTransferDstOptimal && newLayout==vk::ImageLayout::eShaderReadOnlyOptimal)
+    else
     {
-        srcAccess = vk::AccessFlagBits::eTransferWrite;         /*将布局变换为shader只读布局前需等待操作*/
-        dstAccess = vk::AccessFlagBits::eShaderRead;            /*后续传输操作需要等待该函数布局转换完成*/
-        srcStage = vk::PipelineStageFlagBits::eTransfer;        /*屏障需要依赖的前置shader阶段*/
-        dstStage = vk::PipelineStageFlagBits::eFragmentShader;  /*后续管线阶段需要等待该函数布局转换完成*/
+        vk::CommandPoolCreateInfo cmdPoolCreateInfo = {};
+        cmdPoolCreateInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient)  /*命令缓冲生命周期短，整池复位*/
+                         .setQueueFamilyIndex(m_queueFamily);  
+        m_batchPool = VkBase::self().device.createCommandPool(cmdPoolCreateInfo);
+        m_pools.push_back(m_batchPool);
+        vk::CommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.setCommandBufferCount(1)           
+                    .setCommandPool(m_batchPool)
+                    .setLevel(vk::CommandBufferLevel::ePrimary);    /*设置命令缓冲等级为主命令缓冲，可直接提交至队列执行*/
+        m_cmdBuffer = VkBase::self().device.allocateCommandBuffers(allocateInfo)[0];
+        objectCounters().commandPools++;
+        objectCounters().commandBuffers++;
     }
-    else
-        throw std::runtime_error("Unsupported layout transition!");
-    /*1.记录命令*/
-    beginSingleTimeCommands();
-        vk::ImageSubresourceRange subresourceRange;
-        subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor) /*设置转换图像格式受影响的图像范围*/
-                        .setBaseMipLevel(0).setLevelCount(1)            /*设置子资源mipmap起始索引和mipmap数组数量*/
-                        .setBaseArrayLayer(0).setLayerCount(1);         /*设置子资源纹理数组起始索引与数组数量*/
-        vk::ImageMemoryBarrier barrier = {};
-        barrier.setOldLayout(oldLayout)                         /*设置旧图像布局*/
-               .setNewLayout(newLayout)                         /*设置新图像布局*/
-               .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)  /*不转移队列族所有权*/
-               .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)  
-               .setImage(image)                                 /*设置布局变换的图像对象*/
-               .setSubresourceRange(subresourceRange)           /*设置布局变换受影响的区域*/
-               .setSrcAccessMask(srcAccess)     /*设置布局变换依赖的上一资源操作类型*/
-               .setDstAccessMask(dstAccess);    /*设置哪一操作需要等待该屏障（布局变换）完成*/
-        m_cmdBuffer.pipelineBarrier(srcStage, dstStage, vk::DependencyFlags(0), nullptr, nullptr, barrier);
-    endSingleTimeCommands();
+    /*2.开始录制*/
+    vk::CommandBufferBeginInfo cbBeginInfo = {};
+    cbBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)  /*设置命令缓冲使用方法为提交一次*/
+               .setPInheritanceInfo(nullptr);
+    m_cmdBuffer.begin(cbBeginInfo);   /*开始录制命令...*/
+}
 
-    
-    /*2.提交命令*/
-    submit();
-    /*3.复位栅栏并重置命令缓冲*/
-    VkBase::self().device.resetFences(m_fence);
-    m_cmdBuffer.reset();
+void Commander::recordCopy(vk::Buffer src, vk::Buffer dst, const vk::BufferCopy& region)
+{
+    m_cmdBuffer.copyBuffer(src, dst, region); /*执行拷贝内存操作*/
 }
 
+void Commander::recordCopy(vk::Buffer src, vk::Image dst, const vk::BufferImageCopy& region)
+{
+    m_cmdBuffer.copyBufferToImage(src, dst, vk::ImageLayout::eTransferDstOptimal, region);
+}
 
+void Commander::recordLayoutTransition(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+{
+    recordTransition(m_cmdBuffer, image, oldLayout, newLayout);
+}
 
+void Commander::recordCommands(const std::function<void(vk::CommandBuffer)>& record)
+{
+    record(m_cmdBuffer);
+}
 
+CommandToken Commander::submitBatch()
+{
+    if(!m_cmdBuffer)
+        return CommandToken{};
+    m_cmdBuffer.end();
+    /*提交命令缓冲，完成时队列时间线到达该批次的值（即返回的令牌）*/
+    CommandToken token{m_timeline.reserve()};
+    vk::Semaphore timeline = m_timeline.getHandle();
+    vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.setSignalSemaphoreValues(token.value);
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.setPNext(&timelineInfo)
+              .setCommandBuffers(m_cmdBuffer)   /*无需等待指定阶段或信号量*/
+              .setSignalSemaphores(timeline);
+    m_queue.submit(submitInfo);
+    if(m_crossQueue)
+    {
+        /*专用队列与图形队列之间没有提交顺序保证，图形队列使用结果前需等待时间线到达该值*/
+        m_handoff.timeline = timeline;
+        m_handoff.value = token.value;
+        m_handoff.acquireBarriers.insert(m_handoff.acquireBarriers.end(), m_batchAcquires.begin(), m_batchAcquires.end());
+    }
+    m_batchAcquires.clear();
+    m_inflight.push_back({token.value, {m_batchPool, m_cmdBuffer}});
+    m_cmdBuffer = nullptr;
+    m_submitCount++;
+    return token;
+}
 
+CommandToken Commander::submitAsync(const std::function<void(vk::CommandBuffer)>& record)
+{
+    beginBatch();
+    record(m_cmdBuffer);
+    return submitBatch();
+}
 
-void Commander::beginSingleTimeCommands()
+void Commander::recordRelease(vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, uint32_t dstQueueFamily)
 {
-    vk::CommandBufferBeginInfo cbBeginInfo = {};
-    cbBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)  /*设置命令缓冲使用方法为提交一次*/
-               .setPInheritanceInfo(nullptr);
-    m_cmdBuffer.begin(cbBeginInfo);   /*开始录制命令...*/
+    /*同一队列族无需转移所有权，直接做布局变换*/
+    if(dstQueueFamily==m_queueFamily)
+    {
+        recordTransition(m_cmdBuffer, image, oldLayout, newLayout);
+        return;
+    }
+    vk::ImageSubresourceRange subresourceRange;
+    subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor)
+                    .setBaseMipLevel(0).setLevelCount(1)
+                    .setBaseArrayLayer(0).setLayerCount(1);
+    /*1.释放：本队列上的传输写入完成后交出所有权（布局变换在释放与获取之间只执行一次）*/
+    vk::ImageMemoryBarrier barrier = {};
+    barrier.setOldLayout(oldLayout)                         /*释放与获取屏障的布局必须一致*/
+           .setNewLayout(newLayout)
+           .setSrcQueueFamilyIndex(m_queueFamily)           /*当前所有者*/
+           .setDstQueueFamilyIndex(dstQueueFamily)          /*接收所有权的队列族*/
+           .setImage(image)
+           .setSubresourceRange(subresourceRange)
+           .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+           .setDstAccessMask(vk::AccessFlagBits::eNone);   /*释放屏障的目的访问被忽略*/
+    m_cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(0),
+                                nullptr, nullptr, barrier);
+    /*2.获取：由目的队列在使用该图像之前记录*/
+    barrier.setSrcAccessMask(vk::AccessFlagBits::eNone)     /*获取屏障的源访问被忽略（由信号量保证可见）*/
+           .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    m_batchAcquires.push_back(barrier);
 }
-void Commander::endSingleTimeCommands()
+
+QueueHandoff Commander::takeHandoff()
 {
-    m_cmdBuffer.end();
+    QueueHandoff handoff = std::move(m_handoff);
+    m_handoff = QueueHandoff{};
+    return handoff;
 }
-void Commander::submit()
+
+bool Commander::isComplete(CommandToken token)
 {
-    /*提交命令缓冲*/
-    vk::SubmitInfo submitInfo = {};
-    submitInfo.setCommandBuffers(m_cmdBuffer);    /*无需等待指定阶段或fencce/信号量*/
-    VkBase::self().graphicsQueue.submit(submitInfo, m_fence);
-    if(VkBase::self().device.waitForFences(m_fence, false, std::numeric_limits<uint64_t>::max())!=vk::Result::eSuccess)
-        std::cout << "Waiting for copy buffer cmd fence timeout!" << std::endl;
+    return m_timeline.isComplete(token.value);
 }
 
+void Commander::wait(CommandToken token)
+{
+    /*直接等待时间线到达令牌值，无需逐个等待fence*/
+    if(!m_timeline.wait(token.value))
+        std::cout << "Waiting for transfer batch timeline timeout!" << std::endl;
+    collect();
+}
+
+void Commander::collect()
+{
+    /*回收所有已完成批次的命令缓冲（时间线值按提交顺序递增，只需检查队首）*/
+    while(!m_inflight.empty() && m_timeline.isComplete(m_inflight.front().token))
+    {
+        VkBase::self().device.resetCommandPool(m_inflight.front().batch.pool);
+        m_free.push_back(m_inflight.front().batch);
+        m_inflight.pop_front();
+    }
+}
 
-    
-}
\ No newline at end of file
+void Commander::recordTransition(vk::CommandBuffer cmdBuffer, vk::Image image, vk::ImageLayout oldLayout, vk::ImageLayout newLayout)
+{
+    /*0.按新旧布局的典型用法推断屏障依赖条件(操作类型依赖/管线阶段依赖)，任意布局组合均可变换*/
+    ResourceState src = ResourceTracker::stateOf(oldLayout);
+    ResourceState dst = ResourceTracker::stateOf(newLayout);
+    /*1.记录屏障（synchronization2）*/
+    vk::ImageSubresourceRange subresourceRange;
+    subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor) /*设置转换图像格式受影响的图像范围*/
+                    .setBaseMipLevel(0).setLevelCount(VK_REMAINING_MIP_LEVELS)  /*设置子资源mipmap起始索引和mipmap数组数量*/
+                    .setBaseArrayLayer(0).setLayerCount(1);         /*设置子资源纹理数组起始索引与数组数量*/
+    vk::ImageMemoryBarrier2 barrier = {};
+    barrier.setOldLayout(oldLayout)                         /*设置旧图像布局*/
+           .setNewLayout(newLayout)                         /*设置新图像布局*/
+           .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)  /*不转移队列族所有权*/
+           .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)  
+           .setImage(image)                                 /*设置布局变换的图像对象*/
+           .setSubresourceRange(subresourceRange)           /*设置布局变换受影响的区域*/
+           .setSrcStageMask(src.stage)                      /*屏障需要依赖的前置管线阶段*/
+           .setSrcAccessMask(src.access & (vk::AccessFlagBits2::eTransferWrite|vk::AccessFlagBits2::eShaderStorageWrite|
+                                           vk::AccessFlagBits2::eColorAttachmentWrite|vk::AccessFlagBits2::eMemoryWrite))  /*只需刷新之前的写入*/
+           .setDstStageMask(dst.stage)                      /*后续管线阶段需要等待该屏障（布局变换）完成*/
+           .setDstAccessMask(dst.access);                   /*设置哪一操作需要等待该屏障（布局变换）完成*/
+    vk::DependencyInfo dependencyInfo = {};
+    dependencyInfo.setImageMemoryBarriers(barrier);
+    cmdBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+
+
+}
@@ -0,0 +1,181 @@
+#include "defragmenter.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+Defragmenter::Defragmenter(float threshold, uint32_t checkInterval, vk::DeviceSize maxBytesPerPass, uint32_t maxAllocationsPerPass)
+    : m_state(State::eIdle), m_threshold(threshold), m_checkInterval(checkInterval), m_idleFrames(0), m_requested(false),
+      m_maxBytesPerPass(maxBytesPerPass), m_maxAllocationsPerPass(maxAllocationsPerPass), m_context(VK_NULL_HANDLE),
+      m_pass{}, m_passFrame(0), m_lastStats{}
+{
+}
+
+Defragmenter::~Defragmenter()
+{
+    /*仅在设备空闲时析构：直接结束正在进行的pass*/
+    if(m_state==State::eWaiting)
+        endPass();
+    if(m_state!=State::eIdle)
+        finish();
+}
+
+void Defragmenter::update(uint64_t frameNumber, uint64_t completedFrame)
+{
+    /*仅在没有待上传数据（含排队中的调度上传）、待生成mip链和待接收所有权转移的空闲帧中开始新的整理或pass*/
+    auto& base_instance = VkBase::self();
+    bool idleFrame = base_instance.stagingBelt->empty() && base_instance.uploadScheduler->empty() && base_instance.mipmapGenerator->empty()
+                     && (!base_instance.transferCommander || !base_instance.transferCommander->hasHandoff());
+    switch(m_state)
+    {
+    case State::eIdle:
+        if(!idleFrame)
+            return;
+        /*定期检查碎片率，超过阈值或被显式请求时开始整理*/
+        if(++m_idleFrames<m_checkInterval && !m_requested)
+            return;
+        m_idleFrames = 0;
+        if(m_requested || VkBase::self().allocator->getStats().fragmentation>m_threshold)
+            begin();
+        m_requested = false;
+        break;
+    case State::eReady:
+        if(idleFrame)
+            beginPass(frameNumber);
+        break;
+    case State::eWaiting:
+        if(completedFrame>=m_passFrame)
+            endPass();
+        break;
+    }
+}
+
+bool Defragmenter::release(VmaAllocation allocation)
+{
+    /*pass进行中的分配不能直接释放：改为DESTROY操作，由VMA在pass结束时释放源和目标内存*/
+    if(m_state!=State::eWaiting)
+        return false;
+    for(uint32_t i=0; i<m_pass.moveCount; i++)
+    {
+        if(m_pass.pMoves[i].srcAllocation!=allocation)
+            continue;
+        m_pass.pMoves[i].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+        for(auto& move : m_moves)
+        {
+            if(move.index==i)
+                move.owner = nullptr;
+        }
+        return true;
+    }
+    return false;
+}
+
+void Defragmenter::begin()
+{
+    VmaDefragmentationInfo info = {};
+    info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+    info.pool = VK_NULL_HANDLE;                         /*整理所有默认内存池*/
+    info.maxBytesPerPass = m_maxBytesPerPass;           /*限制每个pass的拷贝量，避免单帧卡顿*/
+    info.maxAllocationsPerPass = m_maxAllocationsPerPass;
+    if(vmaBeginDefragmentation(VkBase::self().allocator->getHandle(), &info, &m_context)!=VK_SUCCESS)
+    {
+        std::cout << "[ Defragmenter ]: Can't begin defragmentation!" << std::endl;
+        return;
+    }
+    VkBase::self().allocator->printStats();
+    m_lastStats = {};
+    m_state = State::eReady;
+}
+
+void Defragmenter::beginPass(uint64_t frameNumber)
+{
+    auto& base_instance = VkBase::self();
+    VmaAllocator allocator = base_instance.allocator->getHandle();
+    /*1.获取本pass需要移动的分配*/
+    VkResult res = vmaBeginDefragmentationPass(allocator, m_context, &m_pass);
+    if(res==VK_SUCCESS)
+    {
+        finish();
+        return;
+    }
+    if(res!=VK_INCOMPLETE)
+        throw std::runtime_error("[ Defragmenter ]: Can't begin defragmentation pass!");
+
+    /*2.等待暂存环和专用传输队列上已提交的上传完成，移动拷贝读取的是最终数据*/
+    base_instance.stagingBelt->wait();
+    if(base_instance.transferTimeline)
+        base_instance.transferTimeline->wait(base_instance.transferTimeline->getLastValue());
+
+    /*3.在目标位置重建资源，并在同一命令缓冲中记录所有拷贝*/
+    m_moves.clear();
+    base_instance.commander->execute([&](vk::CommandBuffer cmdBuffer)
+    {
+        for(uint32_t i=0; i<m_pass.moveCount; i++)
+        {
+            VmaAllocationInfo allocInfo = {};
+            vmaGetAllocationInfo(allocator, m_pass.pMoves[i].srcAllocation, &allocInfo);
+            Relocatable* owner = static_cast<Relocatable*>(allocInfo.pUserData);
+            if(!owner)
+            {
+                /*主机可见或无法拷贝的资源不参与移动*/
+                m_pass.pMoves[i].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+            owner->recordRelocation(cmdBuffer, m_pass.pMoves[i].dstTmpAllocation);
+            m_moves.push_back({owner, i});
+        }
+        /*拷贝写入的新资源对之后提交的帧中的读取可见*/
+        vk::MemoryBarrier barrier = {};
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+               .setDstAccessMask(vk::AccessFlagBits::eMemoryRead);
+        cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags(0),
+                                  barrier, nullptr, nullptr);
+    });
+
+    /*4.拷贝已完成（Commander同步等待），后续帧改用新资源；已提交的帧仍可能引用旧资源，旧资源交给延迟销毁队列。
+        缓存的帧命令缓冲中记录着旧的缓冲/视图（及其描述符集），需要重新录制*/
+    for(auto& move : m_moves)
+        base_instance.deletionQueue->push(move.owner->commitRelocation());
+    if(!m_moves.empty() && base_instance.renderer)
+        base_instance.renderer->invalidate();
+    m_passFrame = frameNumber;
+    m_state = State::eWaiting;
+}
+
+void Defragmenter::endPass()
+{
+    /*引用旧资源的帧已全部完成（旧的缓冲/图像对象由延迟销毁队列销毁），结束pass：源分配指向新内存，空的内存块被释放*/
+    VkResult res = vmaEndDefragmentationPass(VkBase::self().allocator->getHandle(), m_context, &m_pass);
+    for(auto& move : m_moves)
+    {
+        if(move.owner)
+            move.owner->refreshAllocation();
+    }
+    m_lastStats.passCount++;
+    m_moves.clear();
+    m_pass = {};
+    m_state = State::eReady;
+    if(res==VK_SUCCESS)
+        finish();
+    else if(res!=VK_INCOMPLETE)
+        throw std::runtime_error("[ Defragmenter ]: Can't end defragmentation pass!");
+}
+
+void Defragmenter::finish()
+{
+    VmaDefragmentationStats stats = {};
+    vmaEndDefragmentation(VkBase::self().allocator->getHandle(), m_context, &stats);
+    m_context = VK_NULL_HANDLE;
+    m_lastStats.allocationsMoved = stats.allocationsMoved;
+    m_lastStats.bytesMoved = stats.bytesMoved;
+    m_lastStats.bytesFreed = stats.bytesFreed;
+    m_lastStats.blocksFreed = stats.deviceMemoryBlocksFreed;
+    std::cout << "[ Defragmenter ]: " << m_lastStats.passCount << " passes, moved " << m_lastStats.allocationsMoved << " allocations ("
+              << m_lastStats.bytesMoved << " bytes), freed " << m_lastStats.blocksFreed << " blocks (" << m_lastStats.bytesFreed << " bytes)" << std::endl;
+    VkBase::self().allocator->printStats();
+    m_state = State::eIdle;
+}
+
+
+
+}
@@ -0,0 +1,49 @@
+#include "deletion_queue.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+DeletionQueue::DeletionQueue()
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    flush();
+}
+
+void DeletionQueue::push(std::function<void()> deleter)
+{
+    /*当前正在录制（或即将录制）的帧仍可能使用该资源*/
+    auto& base_instance = VkBase::self();
+    /*渲染器创建前提交的图形队列工作在第1帧之前执行，第1帧完成时已完成*/
+    uint64_t frame = base_instance.renderer ? base_instance.renderer->getFrameNumber()+1 : 1;
+    m_entries.push_back({frame, std::move(deleter)});
+}
+
+void DeletionQueue::collect(uint64_t completedFrame)
+{
+    /*按提交顺序入队，帧号单调递增，只需检查队首*/
+    while(!m_entries.empty() && m_entries.front().frame<=completedFrame)
+    {
+        auto deleter = std::move(m_entries.front().deleter);
+        m_entries.pop_front();
+        deleter();
+    }
+}
+
+void DeletionQueue::flush()
+{
+    /*仅在设备空闲时调用（程序退出）*/
+    while(!m_entries.empty())
+    {
+        auto deleter = std::move(m_entries.front().deleter);
+        m_entries.pop_front();
+        deleter();
+    }
+}
+
+
+
+}
@@ -29,8 +29,8 @@ vk::DescriptorPool DescriptorManager::createDescriptorPool()
 {
     /*设置描述符集信息*/
     vk::DescriptorPoolSize poolSize;
-    poolSize.setType(vk::DescriptorType::eUniformBuffer)    /*设置描述符集里的描述符类型*/
-            .setDescriptorCount(1);           /*设置描述符集中包含的描述符个数*/
+    poolSize.setType(vk::DescriptorType::eUniformBufferDynamic)    /*设置描述符集里的描述符类型*/
+            .setDescriptorCount(m_inflightCount);                  /*设置池中该类型描述符的总个数*/
 
     /*根据描述符集创建描述符池*/
     vk::DescriptorPoolCreateInfo createInfo = {};
@@ -0,0 +1,81 @@
+#include "gpu_vector.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+GpuVectorBase::GpuVectorBase(vk::BufferUsageFlags usage, vk::DeviceSize capacity)
+    : m_usage(usage|vk::BufferUsageFlagBits::eTransferDst), m_capacity(0), m_uploadedBytes(0)
+{
+    grow(std::max(capacity, minCapacity));
+}
+
+GpuVectorBase::~GpuVectorBase()
+{
+    /*缓冲可能仍被in-flight帧引用，交给延迟销毁队列（程序退出时队列已清空，直接销毁）*/
+    if(m_buffer && VkBase::self().deletionQueue)
+        VkBase::self().deletionQueue->retire(std::move(m_buffer));
+}
+
+void GpuVectorBase::markDirty(vk::DeviceSize begin, vk::DeviceSize end)
+{
+    /*连续修改相邻元素时直接扩展上一区间*/
+    if(!m_dirtyRanges.empty() && begin<=m_dirtyRanges.back().second && end>=m_dirtyRanges.back().first)
+    {
+        m_dirtyRanges.back().first = std::min(m_dirtyRanges.back().first, begin);
+        m_dirtyRanges.back().second = std::max(m_dirtyRanges.back().second, end);
+        return;
+    }
+    m_dirtyRanges.push_back({begin, end});
+}
+
+void GpuVectorBase::upload(const void* data, vk::DeviceSize bytes)
+{
+    m_uploadedBytes = 0;
+    if(bytes==0 || m_dirtyRanges.empty())
+    {
+        m_dirtyRanges.clear();
+        return;
+    }
+    /*1.容量不足时扩容，新缓冲需要完整上传*/
+    if(bytes>m_capacity)
+    {
+        grow(std::max(bytes, m_capacity*2));
+        m_dirtyRanges.assign(1, {0, bytes});
+    }
+    /*2.排序并合并脏区间，间隔很小的区间合并为一次拷贝*/
+    constexpr vk::DeviceSize mergeGap = 256;
+    std::sort(m_dirtyRanges.begin(), m_dirtyRanges.end());
+    std::vector<std::pair<vk::DeviceSize,vk::DeviceSize>> merged;
+    for(auto& range : m_dirtyRanges)
+    {
+        if(range.first>=bytes)
+            continue;   /*元素已被删除*/
+        range.second = std::min(range.second, bytes);
+        if(!merged.empty() && range.first<=merged.back().second+mergeGap)
+            merged.back().second = std::max(merged.back().second, range.second);
+        else
+            merged.push_back(range);
+    }
+    /*3.只上传脏区间*/
+    const char* src = static_cast<const char*>(data);
+    for(auto& range : merged)
+    {
+        VkBase::self().stagingBelt->uploadBuffer(m_buffer->buffer, range.first, src+range.first, range.second-range.first);
+        m_uploadedBytes += range.second-range.first;
+    }
+    m_dirtyRanges.clear();
+}
+
+void GpuVectorBase::grow(vk::DeviceSize bytes)
+{
+    /*旧缓冲可能仍被in-flight帧引用，延迟销毁*/
+    if(m_buffer)
+        VkBase::self().deletionQueue->retire(std::move(m_buffer));
+    m_buffer = std::make_unique<Buffer>(m_usage, bytes, MemoryUsage::eGpuOnly);
+    m_capacity = bytes;
+}
+
+
+
+}
@@ -0,0 +1,389 @@
+#define VMA_IMPLEMENTATION
+#include "memory_allocator.hpp"
+#include "vkBase.hpp"
+#include <sstream>
+#include <algorithm>
+
+
+namespace vulkan2d{
+
+MemoryAllocator::MemoryAllocator(vk::DeviceSize blockSize) : m_categoryStats{}, m_frameIndex(0)
+{
+    auto& base_instance = VkBase::self();
+    /*创建VMA分配器：按内存类型分配大块vk::DeviceMemory，块内使用TLSF空闲链表划分子分配
+      （O(1)分配/释放，并由VMA处理alignment与bufferImageGranularity）*/
+    VmaAllocatorCreateInfo createInfo = {};
+    createInfo.preferredLargeHeapBlockSize = blockSize;  /*大于1GiB的堆上每个内存块的大小（小堆自动取堆大小的1/8）*/
+    createInfo.instance = static_cast<VkInstance>(base_instance.instance);
+    createInfo.physicalDevice = static_cast<VkPhysicalDevice>(base_instance.physicalDevice);
+    createInfo.device = static_cast<VkDevice>(base_instance.device);
+    createInfo.vulkanApiVersion = VK_API_VERSION_1_3;   /*与实例创建时的apiVersion保持一致*/
+    if(base_instance.memoryBudgetSupported)
+        createInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;    /*使用系统提供的显存预算*/
+    if(base_instance.bufferDeviceAddressSupported)
+        createInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;    /*内存块分配时带上VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT*/
+    if(vmaCreateAllocator(&createInfo, &m_allocator)!=VK_SUCCESS)
+        throw std::runtime_error("[ MemoryAllocator ]: Can't create vulkan memory allocator!");
+    /*缓存内存属性表*/
+    m_memoryProperties = base_instance.physicalDevice.getMemoryProperties();
+    m_nonCoherentAtomSize = base_instance.physicalDevice.getProperties().limits.nonCoherentAtomSize;
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    /*销毁前检查各子系统是否有未释放的显存*/
+    for(size_t i=0; i<m_categoryStats.size(); i++)
+    {
+        if(m_categoryStats[i].count!=0)
+            std::cout << "[ MemoryAllocator ]: Leaked " << m_categoryStats[i].count << " " << categoryName(static_cast<MemoryCategory>(i))
+                      << " allocations (" << m_categoryStats[i].bytes << " bytes)!" << std::endl;
+    }
+    vmaDestroyAllocator(m_allocator);
+}
+
+MemoryStats MemoryAllocator::getStats()
+{
+    VmaTotalStatistics totalStats = {};
+    vmaCalculateStatistics(m_allocator, &totalStats);
+
+    MemoryStats stats = {};
+    stats.blockCount = totalStats.total.statistics.blockCount;
+    stats.allocationCount = totalStats.total.statistics.allocationCount;
+    stats.blockBytes = totalStats.total.statistics.blockBytes;
+    stats.allocationBytes = totalStats.total.statistics.allocationBytes;
+    stats.unusedRangeCount = totalStats.total.unusedRangeCount;
+    stats.largestFreeRange = totalStats.total.unusedRangeSizeMax;
+    vk::DeviceSize unusedBytes = stats.blockBytes - stats.allocationBytes;
+    stats.fragmentation = unusedBytes>0 ? 1.0f - float(stats.largestFreeRange)/float(unusedBytes) : 0.0f;
+    return stats;
+}
+
+void MemoryAllocator::printStats()
+{
+    MemoryStats stats = getStats();
+    std::cout << "[ MemoryAllocator ]: " << stats.allocationCount << " allocations in " << stats.blockCount << " blocks, "
+              << stats.allocationBytes << "/" << stats.blockBytes << " bytes used, " << stats.unusedRangeCount << " free ranges, "
+              << "fragmentation " << stats.fragmentation << std::endl;
+}
+
+void MemoryAllocator::newFrame()
+{
+    /*通知VMA进入新的一帧，VMA据此刷新显存预算*/
+    vmaSetCurrentFrameIndex(m_allocator, ++m_frameIndex);
+}
+
+void MemoryAllocator::track(MemoryCategory category, vk::DeviceSize bytes)
+{
+    auto& stats = m_categoryStats[static_cast<size_t>(category)];
+    stats.count++;
+    stats.bytes += bytes;
+}
+
+void MemoryAllocator::untrack(MemoryCategory category, vk::DeviceSize bytes)
+{
+    auto& stats = m_categoryStats[static_cast<size_t>(category)];
+    stats.count--;
+    stats.bytes -= bytes;
+}
+
+std::vector<HeapBudget> MemoryAllocator::getHeapBudgets()
+{
+    std::vector<VmaBudget> vmaBudgets(m_memoryProperties.memoryHeapCount);
+    vmaGetHeapBudgets(m_allocator, vmaBudgets.data());
+
+    std::vector<HeapBudget> budgets(m_memoryProperties.memoryHeapCount);
+    for(uint32_t i=0; i<m_memoryProperties.memoryHeapCount; i++)
+    {
+        budgets[i].flags = m_memoryProperties.memoryHeaps[i].flags;
+        budgets[i].size = m_memoryProperties.memoryHeaps[i].size;
+        budgets[i].budget = vmaBudgets[i].budget;
+        budgets[i].usage = vmaBudgets[i].usage;
+        budgets[i].blockBytes = vmaBudgets[i].statistics.blockBytes;
+        budgets[i].allocationBytes = vmaBudgets[i].statistics.allocationBytes;
+    }
+    return budgets;
+}
+
+std::string MemoryAllocator::dumpStatsJson()
+{
+    MemoryStats stats = getStats();
+    std::stringstream json;
+    json << "{\n";
+    json << "  \"memoryBudgetExtension\": " << (VkBase::self().memoryBudgetSupported ? "true" : "false") << ",\n";
+    json << "  \"total\": { \"blockCount\": " << stats.blockCount << ", \"allocationCount\": " << stats.allocationCount
+         << ", \"blockBytes\": " << stats.blockBytes << ", \"allocationBytes\": " << stats.allocationBytes
+         << ", \"unusedRangeCount\": " << stats.unusedRangeCount << ", \"largestFreeRange\": " << stats.largestFreeRange
+         << ", \"fragmentation\": " << stats.fragmentation << " },\n";
+    json << "  \"categories\": {\n";
+    for(size_t i=0; i<m_categoryStats.size(); i++)
+    {
+        json << "    \"" << categoryName(static_cast<MemoryCategory>(i)) << "\": { \"count\": " << m_categoryStats[i].count
+             << ", \"bytes\": " << m_categoryStats[i].bytes << " }" << (i+1<m_categoryStats.size() ? "," : "") << "\n";
+    }
+    json << "  },\n";
+    json << "  \"heaps\": [\n";
+    std::vector<HeapBudget> budgets = getHeapBudgets();
+    for(size_t i=0; i<budgets.size(); i++)
+    {
+        json << "    { \"index\": " << i
+             << ", \"deviceLocal\": " << ((budgets[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) ? "true" : "false")
+             << ", \"size\": " << budgets[i].size << ", \"budget\": " << budgets[i].budget << ", \"usage\": " << budgets[i].usage
+             << ", \"blockBytes\": " << budgets[i].blockBytes << ", \"allocationBytes\": " << budgets[i].allocationBytes << " }"
+             << (i+1<budgets.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n";
+    json << "}\n";
+    return json.str();
+}
+
+void MemoryAllocator::writeStatsJson(const std::string& filename)
+{
+    std::ofstream file(filename);
+    if(!file.is_open())
+    {
+        std::cout << "Failed to write " << filename << " !" << std::endl;
+        return;
+    }
+    file << dumpStatsJson();
+}
+
+const char* MemoryAllocator::categoryName(MemoryCategory category)
+{
+    switch(category)
+    {
+    case MemoryCategory::eVertex:       return "vertex";
+    case MemoryCategory::eIndex:        return "index";
+    case MemoryCategory::eUniform:      return "uniform";
+    case MemoryCategory::eStaging:      return "staging";
+    case MemoryCategory::eTexture:      return "texture";
+    case MemoryCategory::eRenderTarget: return "renderTarget";
+    default:                            return "other";
+    }
+}
+
+std::vector<uint32_t> MemoryAllocator::rankMemoryTypes(uint32_t typeBits, MemoryUsage usage) const
+{
+    /*按用途对可用内存类型打分排序，分配失败时依次回退到下一候选*/
+    std::vector<std::pair<int, uint32_t>> scored;
+    for(uint32_t i=0; i<m_memoryProperties.memoryTypeCount; i++)
+    {
+        if(!(typeBits & (1u<<i)))
+            continue;
+        int score = scoreMemoryType(i, usage);
+        if(score>=0)
+            scored.push_back({score, i});
+    }
+    std::stable_sort(scored.begin(), scored.end(), [](const auto& a, const auto& b){ return a.first > b.first; });
+
+    std::vector<uint32_t> candidates;
+    for(auto& e : scored)
+        candidates.push_back(e.second);
+    return candidates;
+}
+
+std::vector<uint32_t> MemoryAllocator::filterMemoryTypes(uint32_t typeBits, vk::MemoryPropertyFlags properties) const
+{
+    /*显式指定内存属性时按索引顺序返回满足要求的类型*/
+    std::vector<uint32_t> candidates;
+    for(uint32_t i=0; i<m_memoryProperties.memoryTypeCount; i++)
+    {
+        if(typeBits&(1u<<i) && (m_memoryProperties.memoryTypes[i].propertyFlags&properties)==properties)
+            candidates.push_back(i);
+    }
+    return candidates;
+}
+
+VmaAllocation MemoryAllocator::allocateBuffer(vk::Buffer buffer, const std::vector<uint32_t>& candidates, VmaAllocationInfo& info)
+{
+    for(uint32_t typeIndex : candidates)
+    {
+        VmaAllocationCreateInfo allocCreateInfo = createInfoForType(typeIndex);
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        if(vmaAllocateMemoryForBuffer(m_allocator, static_cast<VkBuffer>(buffer), &allocCreateInfo, &allocation, &info)!=VK_SUCCESS)
+            continue;   /*该类型所在堆空间不足，回退到下一候选*/
+        if(vmaBindBufferMemory(m_allocator, allocation, static_cast<VkBuffer>(buffer))!=VK_SUCCESS)
+        {
+            vmaFreeMemory(m_allocator, allocation);
+            throw std::runtime_error("[ MemoryAllocator ]: Can't bind buffer memory!");
+        }
+        return allocation;
+    }
+    throw std::runtime_error("[ MemoryAllocator ]: Can't find the support memoryType!");
+}
+
+VmaAllocation MemoryAllocator::allocateImage(vk::Image image, const std::vector<uint32_t>& candidates, VmaAllocationInfo& info)
+{
+    for(uint32_t typeIndex : candidates)
+    {
+        VmaAllocationCreateInfo allocCreateInfo = createInfoForType(typeIndex);
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        if(vmaAllocateMemoryForImage(m_allocator, static_cast<VkImage>(image), &allocCreateInfo, &allocation, &info)!=VK_SUCCESS)
+            continue;   /*该类型所在堆空间不足，回退到下一候选*/
+        if(vmaBindImageMemory(m_allocator, allocation, static_cast<VkImage>(image))!=VK_SUCCESS)
+        {
+            vmaFreeMemory(m_allocator, allocation);
+            throw std::runtime_error("[ MemoryAllocator ]: Can't bind image memory!");
+        }
+        return allocation;
+    }
+    throw std::runtime_error("[ MemoryAllocator ]: Can't find the support memoryType!");
+}
+
+int MemoryAllocator::scoreMemoryType(uint32_t typeIndex, MemoryUsage usage) const
+{
+    vk::MemoryPropertyFlags flags = m_memoryProperties.memoryTypes[typeIndex].propertyFlags;
+    /*排除延迟分配/受保护/AMD设备一致性等特殊内存*/
+    if(flags & (vk::MemoryPropertyFlagBits::eLazilyAllocated|vk::MemoryPropertyFlagBits::eProtected|vk::MemoryPropertyFlagBits::eDeviceCoherentAMD))
+        return -1;
+    bool deviceLocal = bool(flags & vk::MemoryPropertyFlagBits::eDeviceLocal);
+    bool hostVisible = bool(flags & vk::MemoryPropertyFlagBits::eHostVisible);
+    bool hostCoherent = bool(flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+    bool hostCached = bool(flags & vk::MemoryPropertyFlagBits::eHostCached);
+
+    int score = 0;
+    switch(usage)
+    {
+    case MemoryUsage::eGpuOnly:
+        score += deviceLocal ? 100 : 0;
+        score += hostVisible ? 0 : 10;      /*不占用稀缺的主机可见显存*/
+        break;
+    case MemoryUsage::eUpload:
+        if(!hostVisible)
+            return -1;
+        score += deviceLocal ? 0 : 50;      /*暂存数据只读一次，留出ReBAR空间*/
+        score += hostCached ? 0 : 10;       /*顺序写入时write-combined更快*/
+        score += hostCoherent ? 1 : 0;      /*同等条件下省去flush*/
+        break;
+    case MemoryUsage::eDynamic:
+        if(!hostVisible)
+            return -1;
+        score += deviceLocal ? 100 : 0;     /*ReBAR：CPU直接写显存，GPU读取无需跨PCIe*/
+        score += hostCached ? 0 : 10;
+        score += hostCoherent ? 1 : 0;
+        break;
+    case MemoryUsage::eReadback:
+        if(!hostVisible)
+            return -1;
+        score += hostCached ? 100 : 0;      /*CPU读取未缓存内存极慢，非一致的缓存内存只需额外invalidate*/
+        score += deviceLocal ? 0 : 10;
+        score += hostCoherent ? 1 : 0;
+        break;
+    }
+    return score;
+}
+
+bool MemoryAllocator::isCoherent(uint32_t typeIndex) const
+{
+    return bool(m_memoryProperties.memoryTypes[typeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+void MemoryAllocator::queueFlush(VmaAllocation allocation, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    queueRange(m_pendingFlushes, allocation, offset, size);
+}
+
+void MemoryAllocator::queueInvalidate(VmaAllocation allocation, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    queueRange(m_pendingInvalidates, allocation, offset, size);
+}
+
+void MemoryAllocator::flushMappedRanges()
+{
+    /*提交前一次性flush本帧所有CPU写入的非一致内存区间*/
+    if(m_pendingFlushes.empty())
+        return;
+    mergeRanges(m_pendingFlushes);
+    std::vector<VmaAllocation> allocations;
+    std::vector<VkDeviceSize> offsets, sizes;
+    for(auto& range : m_pendingFlushes)
+    {
+        allocations.push_back(range.allocation);
+        offsets.push_back(range.offset);
+        sizes.push_back(range.size);
+    }
+    if(vmaFlushAllocations(m_allocator, uint32_t(allocations.size()), allocations.data(), offsets.data(), sizes.data())!=VK_SUCCESS)
+        throw std::runtime_error("[ MemoryAllocator ]: Can't flush mapped memory ranges!");
+    m_pendingFlushes.clear();
+}
+
+void MemoryAllocator::invalidateMappedRanges()
+{
+    /*帧完成后一次性invalidate所有待读取的非一致内存区间*/
+    if(m_pendingInvalidates.empty())
+        return;
+    mergeRanges(m_pendingInvalidates);
+    std::vector<VmaAllocation> allocations;
+    std::vector<VkDeviceSize> offsets, sizes;
+    for(auto& range : m_pendingInvalidates)
+    {
+        allocations.push_back(range.allocation);
+        offsets.push_back(range.offset);
+        sizes.push_back(range.size);
+    }
+    if(vmaInvalidateAllocations(m_allocator, uint32_t(allocations.size()), allocations.data(), offsets.data(), sizes.data())!=VK_SUCCESS)
+        throw std::runtime_error("[ MemoryAllocator ]: Can't invalidate mapped memory ranges!");
+    m_pendingInvalidates.clear();
+}
+
+void MemoryAllocator::dropRanges(VmaAllocation allocation)
+{
+    /*分配释放前调用：丢弃其尚未flush/invalidate的区间，避免之后把已释放的分配传给VMA*/
+    auto matches = [allocation](const MappedRange& range){ return range.allocation==allocation; };
+    m_pendingFlushes.erase(std::remove_if(m_pendingFlushes.begin(), m_pendingFlushes.end(), matches), m_pendingFlushes.end());
+    m_pendingInvalidates.erase(std::remove_if(m_pendingInvalidates.begin(), m_pendingInvalidates.end(), matches), m_pendingInvalidates.end());
+}
+
+void MemoryAllocator::queueRange(std::vector<MappedRange>& ranges, VmaAllocation allocation, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    if(size==0)
+        return;
+    /*按nonCoherentAtomSize向外对齐（VMA会再按内存块中的绝对偏移对齐并截断到分配大小），便于相邻区间合并*/
+    vk::DeviceSize begin = offset / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+    vk::DeviceSize end = (offset + size + m_nonCoherentAtomSize - 1) / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+    /*连续写入同一分配时直接扩展上一区间*/
+    if(!ranges.empty() && ranges.back().allocation==allocation
+       && begin<=ranges.back().offset+ranges.back().size && end>=ranges.back().offset)
+    {
+        vk::DeviceSize mergedBegin = std::min(begin, ranges.back().offset);
+        vk::DeviceSize mergedEnd = std::max(end, ranges.back().offset+ranges.back().size);
+        ranges.back().offset = mergedBegin;
+        ranges.back().size = mergedEnd - mergedBegin;
+        return;
+    }
+    ranges.push_back({allocation, begin, end-begin});
+}
+
+void MemoryAllocator::mergeRanges(std::vector<MappedRange>& ranges)
+{
+    /*按分配和偏移排序，合并重叠或相接的区间*/
+    std::sort(ranges.begin(), ranges.end(), [](const MappedRange& a, const MappedRange& b)
+    {
+        return a.allocation!=b.allocation ? a.allocation<b.allocation : a.offset<b.offset;
+    });
+    std::vector<MappedRange> merged;
+    for(auto& range : ranges)
+    {
+        if(!merged.empty() && merged.back().allocation==range.allocation && range.offset<=merged.back().offset+merged.back().size)
+        {
+            vk::DeviceSize end = std::max(merged.back().offset+merged.back().size, range.offset+range.size);
+            merged.back().size = end - merged.back().offset;
+        }
+        else
+            merged.push_back(range);
+    }
+    ranges.swap(merged);
+}
+
+VmaAllocationCreateInfo MemoryAllocator::createInfoForType(uint32_t typeIndex) const
+{
+    VmaAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.usage = VMA_MEMORY_USAGE_UNKNOWN;
+    allocCreateInfo.memoryTypeBits = 1u << typeIndex;   /*限定VMA只能使用该内存类型*/
+    if(m_memoryProperties.memoryTypes[typeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;  /*主机可见内存持久映射*/
+    return allocCreateInfo;
+}
+
+
+
+}
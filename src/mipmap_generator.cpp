@@ -0,0 +1,255 @@
+#include "mipmap_generator.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+MipmapGenerator::MipmapGenerator(const std::vector<char>& computeSource) : m_pipeline(nullptr)
+{
+    auto& device = VkBase::self().device;
+    m_writeWithoutFormat = VkBase::self().physicalDevice.getFeatures().shaderStorageImageWriteWithoutFormat;
+    /*1.描述符集布局：上一层（采样）与当前层（存储写入）*/
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {};
+    bindings[0].setBinding(0)
+               .setDescriptorCount(1)
+               .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+               .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    bindings[1].setBinding(1)
+               .setDescriptorCount(1)
+               .setDescriptorType(vk::DescriptorType::eStorageImage)
+               .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    vk::DescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.setBindings(bindings);
+    m_setLayout = device.createDescriptorSetLayout(layoutInfo);
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.setSetLayouts(m_setLayout);
+    m_pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+    /*2.描述符池：每生成一层占用一个描述符集，所在帧完成后释放*/
+    m_descriptorPools.push_back(createDescriptorPool());
+    /*3.最近邻采样器（只用texelFetch读取）*/
+    vk::SamplerCreateInfo samplerInfo = {};
+    samplerInfo.setMagFilter(vk::Filter::eNearest)
+               .setMinFilter(vk::Filter::eNearest)
+               .setMipmapMode(vk::SamplerMipmapMode::eNearest)
+               .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+               .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+               .setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+    m_sampler = device.createSampler(samplerInfo);
+    /*4.计算回退管线*/
+    if(!computeSource.empty())
+        createComputePipeline(computeSource);
+}
+
+MipmapGenerator::~MipmapGenerator()
+{
+    auto& device = VkBase::self().device;
+    if(m_pipeline)
+        device.destroyPipeline(m_pipeline);
+    device.destroySampler(m_sampler);
+    for(auto& pool : m_descriptorPools)
+        device.destroyDescriptorPool(pool);
+    device.destroyPipelineLayout(m_pipelineLayout);
+    device.destroyDescriptorSetLayout(m_setLayout);
+}
+
+void MipmapGenerator::createComputePipeline(const std::vector<char>& computeSource)
+{
+    auto& device = VkBase::self().device;
+    vk::ShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.setCodeSize(computeSource.size())
+              .setPCode(reinterpret_cast<const uint32_t*>(computeSource.data()));
+    vk::ShaderModule module = device.createShaderModule(moduleInfo);
+    vk::PipelineShaderStageCreateInfo stageInfo = {};
+    stageInfo.setStage(vk::ShaderStageFlagBits::eCompute)
+             .setModule(module)
+             .setPName("main");
+    vk::ComputePipelineCreateInfo createInfo = {};
+    createInfo.setStage(stageInfo)
+              .setLayout(m_pipelineLayout);
+    auto res = device.createComputePipeline(nullptr, createInfo);
+    device.destroyShaderModule(module);     /*管线创建后不再需要着色器模组*/
+    if(res.result!=vk::Result::eSuccess)
+        throw std::runtime_error("[ MipmapGenerator ]: Can't create mipmap compute pipeline!");
+    m_pipeline = res.value;
+}
+
+uint32_t MipmapGenerator::fullMipChain(uint32_t width, uint32_t height)
+{
+    /*逐层减半直到1x1：floor(log2(max(w,h)))+1*/
+    uint32_t levels = 1;
+    for(uint32_t size=std::max(width, height); size>1; size>>=1)
+        levels++;
+    return levels;
+}
+
+bool MipmapGenerator::supportsBlit(vk::Format format) const
+{
+    vk::FormatFeatureFlags features = VkBase::self().physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+    vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst |
+                                      vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (features & required)==required;
+}
+
+bool MipmapGenerator::supportsCompute(vk::Format format) const
+{
+    vk::FormatFeatureFlags features = VkBase::self().physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+    vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eStorageImage;
+    return m_pipeline && m_writeWithoutFormat && (features & required)==required;
+}
+
+uint32_t MipmapGenerator::maxMipLevels(vk::Format format, uint32_t width, uint32_t height) const
+{
+    /*两条路径都不可用时只保留第0层*/
+    if(!supportsBlit(format) && !supportsCompute(format))
+        return 1;
+    return fullMipChain(width, height);
+}
+
+void MipmapGenerator::request(const Texture& texture)
+{
+    if(texture.mipLevels<=1)
+        return;
+    m_pending[static_cast<VkImage>(texture.image)] = {texture.format, texture.extent.width, texture.extent.height, texture.mipLevels};
+}
+
+void MipmapGenerator::cancel(vk::Image image)
+{
+    m_pending.erase(static_cast<VkImage>(image));
+}
+
+void MipmapGenerator::record(vk::CommandBuffer cmdBuffer, vk::Image image)
+{
+    /*调用时第0层已写入，资源状态跟踪中记录了其当前状态；完成后所有层级处于片段着色器采样状态*/
+    auto it = m_pending.find(static_cast<VkImage>(image));
+    if(it==m_pending.end())
+        return;
+    MipChain chain = it->second;
+    m_pending.erase(it);
+    if(supportsBlit(chain.format))
+        recordBlit(cmdBuffer, image, chain);
+    else
+        recordCompute(cmdBuffer, image, chain);
+    auto& tracker = *VkBase::self().resourceTracker;
+    tracker.useImage(image, ResourceUse::eFragmentSampled);
+    tracker.flush(cmdBuffer);
+}
+
+void MipmapGenerator::recordBlit(vk::CommandBuffer cmdBuffer, vk::Image image, const MipChain& chain)
+{
+    auto& tracker = *VkBase::self().resourceTracker;
+    int32_t width = static_cast<int32_t>(chain.width);
+    int32_t height = static_cast<int32_t>(chain.height);
+    for(uint32_t level=1; level<chain.mipLevels; level++)
+    {
+        /*1.上一层转换为传输源，当前层丢弃旧内容转换为传输目的*/
+        tracker.useImage(image, ResourceUse::eTransferSrc, level-1, 1);
+        tracker.useImage(image, ResourceUse::eTransferDst, level, 1, true);
+        tracker.flush(cmdBuffer);
+        /*2.线性过滤缩小一半*/
+        int32_t dstWidth = std::max(width/2, 1);
+        int32_t dstHeight = std::max(height/2, 1);
+        vk::ImageBlit blit = {};
+        blit.setSrcSubresource(vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, level-1, 0, 1})
+            .setSrcOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{width, height, 1}})
+            .setDstSubresource(vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, level, 0, 1})
+            .setDstOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{dstWidth, dstHeight, 1}});
+        cmdBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+        width = dstWidth;
+        height = dstHeight;
+    }
+}
+
+void MipmapGenerator::recordCompute(vk::CommandBuffer cmdBuffer, vk::Image image, const MipChain& chain)
+{
+    auto& base_instance = VkBase::self();
+    auto& tracker = *base_instance.resourceTracker;
+    /*1.每层一个视图，每次降采样一个描述符集（上一层采样、当前层存储写入）*/
+    std::vector<vk::ImageView> views(chain.mipLevels);
+    for(uint32_t level=0; level<chain.mipLevels; level++)
+        views[level] = createLevelView(image, chain.format, level);
+    std::vector<vk::DescriptorSet> sets;
+    vk::DescriptorPool pool = allocateDescriptorSets(chain.mipLevels-1, sets);
+    for(uint32_t level=1; level<chain.mipLevels; level++)
+    {
+        vk::DescriptorImageInfo srcInfo(m_sampler, views[level-1], vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::DescriptorImageInfo dstInfo(nullptr, views[level], vk::ImageLayout::eGeneral);
+        std::array<vk::WriteDescriptorSet, 2> writes = {};
+        writes[0].setDstSet(sets[level-1]).setDstBinding(0)
+                 .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                 .setImageInfo(srcInfo);
+        writes[1].setDstSet(sets[level-1]).setDstBinding(1)
+                 .setDescriptorType(vk::DescriptorType::eStorageImage)
+                 .setImageInfo(dstInfo);
+        base_instance.device.updateDescriptorSets(writes, nullptr);
+    }
+    /*2.逐层：上一层转换为计算采样，当前层丢弃旧内容转换为通用布局后写入*/
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipeline);
+    for(uint32_t level=1; level<chain.mipLevels; level++)
+    {
+        tracker.useImage(image, ResourceUse::eComputeSampled, level-1, 1);
+        tracker.useImage(image, ResourceUse::eComputeWrite, level, 1, true);
+        tracker.flush(cmdBuffer);
+        uint32_t dstWidth = std::max(chain.width>>level, 1u);
+        uint32_t dstHeight = std::max(chain.height>>level, 1u);
+        cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pipelineLayout, 0, sets[level-1], nullptr);
+        cmdBuffer.dispatch((dstWidth+7)/8, (dstHeight+7)/8, 1);
+    }
+    /*3.视图和描述符集在使用它们的帧完成后销毁*/
+    base_instance.deletionQueue->push([views, sets, pool]()
+    {
+        auto& device = VkBase::self().device;
+        device.freeDescriptorSets(pool, sets);
+        for(auto& view : views)
+            device.destroyImageView(view);
+    });
+}
+
+vk::DescriptorPool MipmapGenerator::createDescriptorPool()
+{
+    std::array<vk::DescriptorPoolSize, 2> poolSizes = {};
+    poolSizes[0].setType(vk::DescriptorType::eCombinedImageSampler).setDescriptorCount(64);
+    poolSizes[1].setType(vk::DescriptorType::eStorageImage).setDescriptorCount(64);
+    vk::DescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+            .setPoolSizes(poolSizes)
+            .setMaxSets(64);     /*一条mip链最多32层，单个池总能容纳*/
+    return VkBase::self().device.createDescriptorPool(poolInfo);
+}
+
+vk::DescriptorPool MipmapGenerator::allocateDescriptorSets(uint32_t count, std::vector<vk::DescriptorSet>& sets)
+{
+    /*描述符集在帧完成后才释放，同一帧生成很多层级时现有的池可能已满：依次尝试（从最新的池开始），都不够时创建新池*/
+    auto& device = VkBase::self().device;
+    std::vector<vk::DescriptorSetLayout> layouts(count, m_setLayout);
+    sets.resize(count);
+    vk::DescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.setSetLayouts(layouts);
+    for(auto it=m_descriptorPools.rbegin(); it!=m_descriptorPools.rend(); it++)
+    {
+        allocateInfo.setDescriptorPool(*it);
+        vk::Result res = device.allocateDescriptorSets(&allocateInfo, sets.data());
+        if(res==vk::Result::eSuccess)
+            return *it;
+        if(res!=vk::Result::eErrorOutOfPoolMemory && res!=vk::Result::eErrorFragmentedPool)
+            throw std::runtime_error("[ MipmapGenerator ]: Can't allocate mipmap descriptor sets!");
+    }
+    m_descriptorPools.push_back(createDescriptorPool());
+    allocateInfo.setDescriptorPool(m_descriptorPools.back());
+    if(device.allocateDescriptorSets(&allocateInfo, sets.data())!=vk::Result::eSuccess)
+        throw std::runtime_error("[ MipmapGenerator ]: Can't allocate mipmap descriptor sets!");
+    return m_descriptorPools.back();
+}
+
+vk::ImageView MipmapGenerator::createLevelView(vk::Image image, vk::Format format, uint32_t level)
+{
+    vk::ImageViewCreateInfo createInfo = {};
+    createInfo.setImage(image)
+              .setViewType(vk::ImageViewType::e2D)
+              .setFormat(format)
+              .setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, level, 1, 0, 1});
+    return VkBase::self().device.createImageView(createInfo);
+}
+
+
+
+}
@@ -0,0 +1,45 @@
+#include "object_pool.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+ObjectCounters& objectCounters()
+{
+    static ObjectCounters counters;
+    return counters;
+}
+
+SyncPool::SyncPool()
+{
+}
+
+SyncPool::~SyncPool()
+{
+    for(auto& semaphore : m_semaphores)
+        VkBase::self().device.destroySemaphore(semaphore);
+}
+
+vk::Semaphore SyncPool::acquireSemaphore()
+{
+    if(!m_freeSemaphores.empty())
+    {
+        vk::Semaphore semaphore = m_freeSemaphores.back();
+        m_freeSemaphores.pop_back();
+        return semaphore;
+    }
+    vk::SemaphoreCreateInfo createInfo = {};
+    vk::Semaphore semaphore = VkBase::self().device.createSemaphore(createInfo);
+    m_semaphores.push_back(semaphore);
+    objectCounters().semaphores++;
+    return semaphore;
+}
+
+void SyncPool::releaseSemaphore(vk::Semaphore semaphore)
+{
+    m_freeSemaphores.push_back(semaphore);
+}
+
+
+
+}
@@ -0,0 +1,121 @@
+#include "parallel_recorder.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+ParallelRecorder::ParallelRecorder(uint32_t threadCount)
+    : m_generation(0), m_busy(0), m_quit(false), m_nextTask(0), m_tasks(nullptr), m_inheritance(nullptr)
+{
+    /*默认每个硬件线程一个录制线程（主线程也参与录制）*/
+    if(threadCount==0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t graphicsFamily = VkBase::self().queueFamilyIndex.graphicsIndex.value();
+    for(uint32_t i=1; i<threadCount; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->commandManager = std::make_unique<CommandManager>(graphicsFamily);
+        m_workers.push_back(std::move(worker));
+    }
+    for(auto& worker : m_workers)
+        worker->thread = std::thread(&ParallelRecorder::run, this, std::ref(*worker));
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for(auto& worker : m_workers)
+        worker->thread.join();
+    m_workers.clear();
+}
+
+void ParallelRecorder::beginFrame(uint32_t slot)
+{
+    /*在主线程上调用，此时工作线程空闲：复位各线程在该槽位的命令池*/
+    for(auto& worker : m_workers)
+        worker->commandManager->beginFrame(slot);
+}
+
+std::vector<vk::CommandBuffer> ParallelRecorder::record(const vk::CommandBufferInheritanceInfo& inheritance, const std::vector<Task>& tasks)
+{
+    /*1.发布本批任务，唤醒工作线程*/
+    m_results.assign(tasks.size(), nullptr);
+    m_error = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks = &tasks;
+        m_inheritance = &inheritance;
+        m_nextTask = 0;
+        m_busy = static_cast<uint32_t>(m_workers.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    /*2.主线程使用自己的命令管理器一起领取任务*/
+    drain(*VkBase::self().commandManager);
+
+    /*3.等待工作线程录制完成*/
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this](){ return m_busy==0; });
+        m_tasks = nullptr;
+        m_inheritance = nullptr;
+    }
+    if(m_error)
+        std::rethrow_exception(m_error);
+    return m_results;
+}
+
+void ParallelRecorder::run(Worker& worker)
+{
+    uint64_t generation = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&](){ return m_quit || m_generation!=generation; });
+            if(m_quit)
+                return;
+            generation = m_generation;
+        }
+        drain(*worker.commandManager);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+        m_done.notify_one();
+    }
+}
+
+void ParallelRecorder::drain(CommandManager& commandManager)
+{
+    /*任务按下标原子领取，结果写入对应位置（各线程写入不同元素）*/
+    vk::CommandBufferBeginInfo beginInfo = {};
+    beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit|vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+             .setPInheritanceInfo(m_inheritance);
+    for(uint32_t index = m_nextTask++; index<m_tasks->size(); index = m_nextTask++)
+    {
+        try
+        {
+            vk::CommandBuffer cmdBuffer = commandManager.allocateCommandBuffer(vk::CommandBufferLevel::eSecondary);
+            cmdBuffer.begin(beginInfo);
+            (*m_tasks)[index](cmdBuffer);
+            cmdBuffer.end();
+            m_results[index] = cmdBuffer;
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_error)
+                m_error = std::current_exception();
+        }
+    }
+}
+
+
+
+}
@@ -0,0 +1,286 @@
+#include "readback.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+bool ReadbackImage::supportsPpm(vk::Format format)
+{
+    switch(format)
+    {
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Snorm:
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Snorm:
+        case vk::Format::eB8G8R8A8Srgb:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void ReadbackImage::writePpm(const std::string& filename) const
+{
+    /*二进制PPM（P6）：只写RGB，BGRA格式交换红蓝通道*/
+    if(!supportsPpm(format))
+        throw std::runtime_error("[ Readback ]: Only 8-bit RGBA/BGRA images can be written as PPM!");
+    bool bgra = format==vk::Format::eB8G8R8A8Unorm || format==vk::Format::eB8G8R8A8Srgb || format==vk::Format::eB8G8R8A8Snorm;
+    std::ofstream file(filename, std::ios::binary);
+    if(!file.is_open())
+        throw std::runtime_error("[ Readback ]: Can't open " + filename + "!");
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<char> row(width*3);
+    for(uint32_t y=0; y<height; y++)
+    {
+        const char* src = pixels.data() + size_t(y)*width*4;
+        for(uint32_t x=0; x<width; x++)
+        {
+            row[x*3+0] = src[x*4 + (bgra ? 2 : 0)];
+            row[x*3+1] = src[x*4 + 1];
+            row[x*3+2] = src[x*4 + (bgra ? 0 : 2)];
+        }
+        file.write(row.data(), row.size());
+    }
+}
+
+Readback::Readback()
+{
+}
+
+Readback::~Readback()
+{
+    /*调用时设备已空闲，未兑现的future得到broken_promise*/
+}
+
+vk::DeviceSize Readback::texelSize(vk::Format format)
+{
+    switch(format)
+    {
+        case vk::Format::eR8Unorm:
+            return 1;
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Snorm:
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Snorm:
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eR32Uint:
+        case vk::Format::eR32Sfloat:
+            return 4;
+        case vk::Format::eR16G16B16A16Sfloat:
+            return 8;
+        case vk::Format::eR32G32B32A32Sfloat:
+            return 16;
+        default:
+            throw std::runtime_error("[ Readback ]: Unsupported readback format!");
+    }
+}
+
+std::future<std::vector<char>> Readback::readBuffer(vk::Buffer src, vk::DeviceSize offset, vk::DeviceSize size)
+{
+    auto promise = std::make_shared<std::promise<std::vector<char>>>();
+    Request request = {};
+    request.source = Source::eBuffer;
+    request.buffer = src;
+    request.offset = offset;
+    request.size = size;
+    request.deliver = [promise](Request&, std::vector<char>&& data){ promise->set_value(std::move(data)); };
+    m_queued.push_back(std::move(request));
+    return promise->get_future();
+}
+
+std::future<ReadbackImage> Readback::readImage(vk::Image src, uint32_t width, uint32_t height, vk::Format format, uint32_t mipLevel, ResourceUse after)
+{
+    Request request = {};
+    request.source = Source::eImage;
+    request.image = src;
+    request.width = std::max(width>>mipLevel, 1u);
+    request.height = std::max(height>>mipLevel, 1u);
+    request.format = format;
+    request.mipLevel = mipLevel;
+    request.after = after;
+    return queueImage(std::move(request));
+}
+
+std::future<ReadbackImage> Readback::captureFrame()
+{
+    /*拷贝下一帧渲染完成、即将显示的交换链图像*/
+    auto& swapchain = *VkBase::self().swapchain;
+    Request request = {};
+    request.source = Source::eSwapchain;
+    request.width = swapchain.getExtent().width;
+    request.height = swapchain.getExtent().height;
+    request.format = swapchain.getFormat().format;
+    if(!swapchain.supportsCapture())
+    {
+        std::promise<ReadbackImage> promise;
+        promise.set_exception(std::make_exception_ptr(std::runtime_error("[ Readback ]: Swapchain images can't be used as transfer source!")));
+        return promise.get_future();
+    }
+    return queueImage(std::move(request));
+}
+
+void Readback::saveScreenshot(const std::string& filename)
+{
+    /*完成后在update中直接写文件，调用者无需持有future*/
+    auto& swapchain = *VkBase::self().swapchain;
+    if(!swapchain.supportsCapture())
+    {
+        std::cout << "[ Readback ]: Screenshots are not supported by this swapchain!" << std::endl;
+        return;
+    }
+    /*HDR/10位等交换链格式无法写成PPM：排队前拒绝，不在渲染循环中抛出*/
+    if(!ReadbackImage::supportsPpm(swapchain.getFormat().format))
+    {
+        std::cout << "[ Readback ]: Screenshots are not supported for the swapchain format " << vk::to_string(swapchain.getFormat().format) << "!" << std::endl;
+        return;
+    }
+    Request request = {};
+    request.source = Source::eSwapchain;
+    request.width = swapchain.getExtent().width;
+    request.height = swapchain.getExtent().height;
+    request.format = swapchain.getFormat().format;
+    request.size = request.width * request.height * texelSize(request.format);
+    request.deliver = [filename](Request& request, std::vector<char>&& data)
+    {
+        /*在Readback::update（渲染循环）中调用：写文件失败只打印，不中断渲染*/
+        try
+        {
+            ReadbackImage image = {request.width, request.height, request.format, std::move(data)};
+            image.writePpm(filename);
+            std::cout << "Screenshot saved to " << filename << std::endl;
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << e.what() << std::endl;
+        }
+    };
+    m_queued.push_back(std::move(request));
+}
+
+std::future<ReadbackImage> Readback::queueImage(Request&& request)
+{
+    auto promise = std::make_shared<std::promise<ReadbackImage>>();
+    request.size = request.width * request.height * texelSize(request.format);
+    request.deliver = [promise](Request& request, std::vector<char>&& data)
+    {
+        promise->set_value(ReadbackImage{request.width, request.height, request.format, std::move(data)});
+    };
+    m_queued.push_back(std::move(request));
+    return promise->get_future();
+}
+
+void Readback::record(vk::CommandBuffer cmdBuffer, vk::Image swapchainImage)
+{
+    /*在帧命令缓冲的渲染流程之后调用：本帧之前的所有写入对拷贝可见*/
+    if(m_queued.empty())
+        return;
+    vk::MemoryBarrier2 barrier = {};
+    barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eAllCommands)
+           .setSrcAccessMask(vk::AccessFlagBits2::eMemoryWrite)
+           .setDstStageMask(vk::PipelineStageFlagBits2::eTransfer)
+           .setDstAccessMask(vk::AccessFlagBits2::eTransferRead);
+    cmdBuffer.pipelineBarrier2(vk::DependencyInfo{}.setMemoryBarriers(barrier));
+    while(!m_queued.empty())
+    {
+        Request request = std::move(m_queued.front());
+        m_queued.pop_front();
+        request.staging = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eTransferDst, request.size, MemoryUsage::eReadback);
+        recordRequest(cmdBuffer, request, swapchainImage);
+        m_recorded.push_back(std::move(request));
+    }
+    /*拷贝写入对主机读取可见*/
+    barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
+           .setSrcAccessMask(vk::AccessFlagBits2::eTransferWrite)
+           .setDstStageMask(vk::PipelineStageFlagBits2::eHost)
+           .setDstAccessMask(vk::AccessFlagBits2::eHostRead);
+    cmdBuffer.pipelineBarrier2(vk::DependencyInfo{}.setMemoryBarriers(barrier));
+}
+
+void Readback::recordRequest(vk::CommandBuffer cmdBuffer, Request& request, vk::Image swapchainImage)
+{
+    auto& tracker = *VkBase::self().resourceTracker;
+    vk::Buffer dst = request.staging->buffer;
+    if(request.source==Source::eBuffer)
+    {
+        tracker.useBuffer(request.buffer, ResourceUse::eTransferSrc);
+        tracker.flush(cmdBuffer);
+        cmdBuffer.copyBuffer(request.buffer, dst, vk::BufferCopy{request.offset, 0, request.size});
+        return;
+    }
+    vk::BufferImageCopy region = {};
+    region.setBufferOffset(0)
+          .setBufferRowLength(0)        /*紧凑对齐*/
+          .setBufferImageHeight(0)
+          .setImageSubresource(vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, request.mipLevel, 0, 1})
+          .setImageOffset(vk::Offset3D{0, 0, 0})
+          .setImageExtent(vk::Extent3D{request.width, request.height, 1});
+    if(request.source==Source::eImage)
+    {
+        /*登记过的图像由资源状态跟踪生成屏障，拷贝后恢复到指定用途*/
+        tracker.useImage(request.image, ResourceUse::eTransferSrc, request.mipLevel, 1);
+        tracker.flush(cmdBuffer);
+        cmdBuffer.copyImageToBuffer(request.image, vk::ImageLayout::eTransferSrcOptimal, dst, region);
+        tracker.useImage(request.image, request.after, request.mipLevel, 1);
+        tracker.flush(cmdBuffer);
+        return;
+    }
+    /*交换链图像不在资源状态跟踪中：渲染流程结束后处于显示布局，拷贝后转换回去*/
+    vk::ImageMemoryBarrier2 barrier = {};
+    barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eColorAttachmentOutput)
+           .setSrcAccessMask(vk::AccessFlagBits2::eColorAttachmentWrite)
+           .setDstStageMask(vk::PipelineStageFlagBits2::eTransfer)
+           .setDstAccessMask(vk::AccessFlagBits2::eTransferRead)
+           .setOldLayout(vk::ImageLayout::ePresentSrcKHR)
+           .setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+           .setImage(swapchainImage)
+           .setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
+    cmdBuffer.pipelineBarrier2(vk::DependencyInfo{}.setImageMemoryBarriers(barrier));
+    cmdBuffer.copyImageToBuffer(swapchainImage, vk::ImageLayout::eTransferSrcOptimal, dst, region);
+    barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eTransfer)
+           .setSrcAccessMask(vk::AccessFlagBits2::eNone)     /*只读，无需可见性*/
+           .setDstStageMask(vk::PipelineStageFlagBits2::eNone)
+           .setDstAccessMask(vk::AccessFlagBits2::eNone)
+           .setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+           .setNewLayout(vk::ImageLayout::ePresentSrcKHR);
+    cmdBuffer.pipelineBarrier2(vk::DependencyInfo{}.setImageMemoryBarriers(barrier));
+}
+
+void Readback::submit(uint64_t timelineValue)
+{
+    /*帧命令缓冲提交时记录其时间线值*/
+    for(auto& request : m_recorded)
+    {
+        request.value = timelineValue;
+        m_inflight.push_back(std::move(request));
+    }
+    m_recorded.clear();
+}
+
+void Readback::update()
+{
+    /*每帧开始时查询一次时间线，兑现已完成的回读（不等待）*/
+    auto& base_instance = VkBase::self();
+    std::vector<Request> completed;
+    while(!m_inflight.empty() && base_instance.graphicsTimeline->isComplete(m_inflight.front().value))
+    {
+        m_inflight.front().staging->invalidate();
+        completed.push_back(std::move(m_inflight.front()));
+        m_inflight.pop_front();
+    }
+    if(completed.empty())
+        return;
+    base_instance.allocator->invalidateMappedRanges();
+    for(auto& request : completed)
+    {
+        const char* src = static_cast<const char*>(request.staging->data);
+        std::vector<char> data(src, src+request.size);
+        request.staging.reset();
+        request.deliver(request, std::move(data));
+    }
+}
+
+
+
+}
@@ -16,8 +16,16 @@ RenderProcess::RenderProcess()
     if(!renderPass)
         throw std::runtime_error("[ RenderPass ]: Can't create renderPass!");
 
+    /*创建精灵管线布局*/
+    spritePipelineLayout = createSpriteLayout();
+
     graphicsPipeline_triangle = nullptr;
     graphicsPipeline_line = nullptr;
+    graphicsPipeline_pull = nullptr;
+    graphicsPipeline_sprite = nullptr;
+    graphicsPipeline_spriteAdditive = nullptr;
+    graphicsPipeline_spriteInstanced = nullptr;
+    graphicsPipeline_spriteInstancedAdditive = nullptr;
     
 }
 
@@ -27,18 +35,29 @@ RenderProcess::~RenderProcess()
     
     base_instance.device.destroyRenderPass(renderPass);
     base_instance.device.destroyPipelineLayout(pipelineLayout);
+    base_instance.device.destroyPipelineLayout(spritePipelineLayout);
 }
 
 vk::PipelineLayout RenderProcess::createLayout()
 {
+    vk::PushConstantRange pushConstantRange = {};
+    pushConstantRange.setStageFlags(vk::ShaderStageFlagBits::eVertex)   /*顶点拉取模式的顶点数据地址*/
+                     .setOffset(0)
+                     .setSize(sizeof(VertexPullConstants));
     vk::PipelineLayoutCreateInfo createInfo = {};
     createInfo.setSetLayouts(VkBase::self().shader->getDescriptorSetLayouts())          /*设置管线布局*/
-              .setPushConstantRangeCount(0)     /*设置常量值个数*/
-              .setPPushConstantRanges(nullptr); /*设置常量值*/
+              .setPushConstantRanges(pushConstantRange);    /*设置常量值*/
     
     return VkBase::self().device.createPipelineLayout(createInfo);
 }
 
+vk::PipelineLayout RenderProcess::createSpriteLayout()
+{
+    vk::PipelineLayoutCreateInfo createInfo = {};
+    createInfo.setSetLayouts(VkBase::self().spriteShader->getDescriptorSetLayouts());   /*uniform与纹理两个描述符集*/
+    return VkBase::self().device.createPipelineLayout(createInfo);
+}
+
 vk::RenderPass RenderProcess::createRenderPass()
 {
     auto& base_instance = VkBase::self();
@@ -82,7 +101,21 @@ vk::RenderPass RenderProcess::createRenderPass()
     return base_instance.device.createRenderPass(createInfo);
 }
 
-vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology topology) 
+vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::PrimitiveTopology topology, bool vertexPulling) 
+{
+    PipelineConfig config = {};
+    config.topology = topology;
+    if(!vertexPulling)  /*顶点拉取模式不使用固定顶点输入，任意顶点格式共用一条管线*/
+    {
+        auto bindingDescrptions = Vertex::getBindingDescriptions();
+        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        config.bindings.assign(bindingDescrptions.begin(), bindingDescrptions.end());
+        config.attributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+    }
+    return createGraphicsPipeline(shader, config);
+}
+
+vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, const PipelineConfig& config)
 {
     /* [可编程部分]: shader */
     /*0.设置shader在管线中的对应信息*/
@@ -100,14 +133,12 @@ vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::Pri
     /* [固定部分]: 设置管线固定部分的参数 */
     /*1.顶点输入*/
     vk::PipelineVertexInputStateCreateInfo vertexInputStateInfo = {};   
-    auto bindingDescrptions = Vertex::getBindingDescriptions();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-    vertexInputStateInfo.setVertexBindingDescriptions(bindingDescrptions)     /*设置绑定描述体数组，设置数据间距和组织方式（逐顶点/逐实例）*/
-                        .setVertexAttributeDescriptions(attributeDescriptions);  /*设置属性描述体数组，将属性传递给顶点着色器中的变量*/
+    vertexInputStateInfo.setVertexBindingDescriptions(config.bindings)      /*设置绑定描述体数组，设置数据间距和组织方式（逐顶点/逐实例）*/
+                        .setVertexAttributeDescriptions(config.attributes); /*设置属性描述体数组，将属性传递给顶点着色器中的变量*/
 
     /*2.输入装配*/
     vk::PipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo = {};
-    inputAssemblyStateInfo.setTopology(topology)                /*设置渲染管线使用的图元拓扑*/
+    inputAssemblyStateInfo.setTopology(config.topology)         /*设置渲染管线使用的图元拓扑*/
                           .setPrimitiveRestartEnable(false);    /*是否启用图元重启（特殊index之后重置index=0）*/
 
     /*3.视口和裁剪*/
@@ -127,7 +158,7 @@ vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::Pri
     /*4.光栅化*/
     vk::PipelineRasterizationStateCreateInfo rasterizationStateInfo = {};
     rasterizationStateInfo.setFrontFace(vk::FrontFace::eCounterClockwise)      /*设置多边形正面索引方向（索引顺时针/逆时针）*/
-                          .setCullMode(vk::CullModeFlagBits::eBack)     /*设置剔除模式为背面剔除*/
+                          .setCullMode(config.cullMode)                 /*设置剔除模式（默认背面剔除）*/
                           .setPolygonMode(vk::PolygonMode::eFill)       /*设置多边形在片段着色器着色方式为填充模式*/
                           .setLineWidth(1.0)                            /*设置光栅化后线段宽度（像素）*/
                           .setRasterizerDiscardEnable(false)            /*是否丢弃光栅化过程*/
@@ -146,12 +177,17 @@ vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::Pri
     /*6.深度和模板测试*/
      
     /*7.颜色混合*/
-    // finalRGB = 1*newRGB + 0*oldRGB
+    // eOpaque:   finalRGB = 1*newRGB + 0*oldRGB
+    // eAlpha:    finalRGB = newA*newRGB + (1-newA)*oldRGB
+    // eAdditive: finalRGB = newA*newRGB + 1*oldRGB
     // finalA   = 1*newA + 0*oldA
+    vk::BlendFactor srcColorFactor = config.blend==BlendMode::eOpaque ? vk::BlendFactor::eOne : vk::BlendFactor::eSrcAlpha;
+    vk::BlendFactor dstColorFactor = config.blend==BlendMode::eAlpha ? vk::BlendFactor::eOneMinusSrcAlpha :
+                                     config.blend==BlendMode::eAdditive ? vk::BlendFactor::eOne : vk::BlendFactor::eZero;
     vk::PipelineColorBlendAttachmentState colorBlendAttachmentState = {};   /*设置绑定的帧缓冲颜色混合*/
     colorBlendAttachmentState.setBlendEnable(true)
-                             .setSrcColorBlendFactor(vk::BlendFactor::eOne)     /*设置新缓冲区rgb值系数*/
-                             .setDstColorBlendFactor(vk::BlendFactor::eZero)    /*设置旧缓冲区rgb值系数*/
+                             .setSrcColorBlendFactor(srcColorFactor)            /*设置新缓冲区rgb值系数*/
+                             .setDstColorBlendFactor(dstColorFactor)            /*设置旧缓冲区rgb值系数*/
                              .setColorBlendOp(vk::BlendOp::eAdd)                /*设置混合操作*/
                              .setSrcAlphaBlendFactor(vk::BlendFactor::eOne)     /*设置新缓冲区alpha值系数*/
                              .setDstAlphaBlendFactor(vk::BlendFactor::eZero)    /*设置新缓冲区alpha值系数*/
@@ -187,7 +223,7 @@ vk::Pipeline RenderProcess::createGraphicsPipeline(const Shader& shader, vk::Pri
               .setPDepthStencilState(nullptr)                       /*设置深度和模板信息*/
               .setPColorBlendState(&colorBlendStateInfo)            /*设置渲染前后颜色混合信息*/
               .setPDynamicState(&dynamicStateInfo)                  /*设置渲染过程可变参数信息*/
-              .setLayout(pipelineLayout)                            /*设置管线布局（常量）*/
+              .setLayout(config.layout ? config.layout : pipelineLayout)    /*设置管线布局（常量）*/
               .setRenderPass(renderPass)                            /*设置渲染流程*/
               .setSubpass(0)                                        /*设置渲染子流程索引index*/
               .setBasePipelineHandle(nullptr)                       /*设置基类管线句柄*/
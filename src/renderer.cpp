@@ -4,56 +4,91 @@
 
 namespace vulkan2d{
 
-Renderer::Renderer(int maxFlightCount) : m_currentFrame(0), m_maxFlightCount(maxFlightCount)
+Renderer::Renderer(int flightCount) : m_currentFrame(0), m_uniformOffset(0), m_frameNumber(0), m_completedFrame(0), m_latencyMs(0.0),
+                                      m_recordVersion(1), m_recordCount(0)
 {
-    size_t swapchainSize = VkBase::self().swapchain->images.size();
-    m_flightCount = (swapchainSize>m_maxFlightCount) ? m_maxFlightCount : swapchainSize;
-    m_commandbuffers = createCommandBuffers();
+    /*in-flight帧数与交换链图像数无关：每帧资源按最大值分配，交换链图像的占用单独跟踪*/
+    m_flightCount = std::clamp(flightCount, 1, maxFlightCount);
+    m_inflightFrameNumbers.resize(maxFlightCount, 0);
+    m_inflightValues.resize(maxFlightCount, 0);
+    m_frameStartTimes.resize(maxFlightCount);
+    m_commandbuffers.resize(maxFlightCount);
+    m_cachedCommandBuffers.resize(maxFlightCount);
+    vk::CommandPoolCreateInfo poolInfo = {};
+    poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+            .setQueueFamilyIndex(VkBase::self().queueFamilyIndex.graphicsIndex.value());
+    m_cachePool = VkBase::self().device.createCommandPool(poolInfo);
+    objectCounters().commandPools++;
     m_descriptorSets = createDescriptorSets();
-    initFences();
     initSemaphores();
+    trackSwapchainImages();
 }
 Renderer::~Renderer()
 {
     auto& base_instance = VkBase::self(); 
-    for(int i=0; i<m_flightCount; i++)
-    {
-        base_instance.device.destroySemaphore(m_renderFinishedSemaphores[i]);
-        base_instance.device.destroySemaphore(m_imageAvailbleSemaphores[i]);
-    }
-    for(int i=0; i<m_flightCount; i++)
-        base_instance.device.destroyFence(m_inflightFences[i]);
+    for(auto& semaphore : m_imageAvailbleSemaphores)
+        base_instance.syncPool->releaseSemaphore(semaphore);
+    for(auto& semaphore : m_renderFinishedSemaphores)
+        base_instance.syncPool->releaseSemaphore(semaphore);
+    base_instance.device.destroyCommandPool(m_cachePool);   /*同时释放缓存的命令缓冲*/
 
 }
 
-void Renderer::updateDescriptorSets(const std::vector<std::unique_ptr<Buffer>>& buffers)
+void Renderer::setFlightCount(int flightCount)
 {
-    /*配置描述符*/
-    for(int i=0; i<m_flightCount; i++)
-    {
-        vk::DescriptorBufferInfo bufferInfo = {};
-        bufferInfo.setBuffer(buffers[i]->buffer)            /*设置绑定的描述符缓冲*/
-                  .setOffset(0)                             /*设置该缓冲偏移量*/
-                  .setRange(sizeof(UniformBufferObject));   /*设置描述符缓冲大小*/
-        
-        vk::WriteDescriptorSet descriptorWrite = {};
-        descriptorWrite.dstSet = m_descriptorSets[i];                       /*设置待更新描述符所属的描述符集*/
-        descriptorWrite.dstBinding = 0;                                     /*设置该描述符集绑定的shader对应索引*/
-        descriptorWrite.dstArrayElement = 0;                                /*设置目标描述符所在数组中的索引*/
-        descriptorWrite.descriptorType = vk::DescriptorType::eUniformBuffer;/*设置描述符类型*/
-        descriptorWrite.descriptorCount = 1;                                /*设置描述符数量*/
-        descriptorWrite.pBufferInfo = &bufferInfo;                          /*设置描述符绑定的缓冲信息*/
-        VkBase::self().device.updateDescriptorSets(descriptorWrite, nullptr);
-    }
+    flightCount = std::clamp(flightCount, 1, maxFlightCount);
+    if(flightCount==m_flightCount)
+        return;
+    /*槽位映射随帧数改变：先等待所有in-flight帧完成（只在切换模式时停顿一次）*/
+    for(auto value : m_inflightValues)
+        VkBase::self().graphicsTimeline->wait(value);
+    updateCompletedFrame();
+    m_flightCount = flightCount;
+    m_currentFrame = 0;
+}
+
+void Renderer::updateDescriptorSets(const RingBuffer& uniformRing)
+{
+    /*配置描述符：所有帧共用一个描述符集，绘制时通过dynamic offset选择环形缓冲中的数据*/
+    vk::DescriptorBufferInfo bufferInfo = {};
+    bufferInfo.setBuffer(uniformRing.getBuffer())       /*设置绑定的描述符缓冲*/
+              .setOffset(0)                             /*设置该缓冲偏移量（实际偏移由dynamic offset给出）*/
+              .setRange(sizeof(UniformBufferObject));   /*设置描述符缓冲大小*/
+    
+    vk::WriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.dstSet = m_descriptorSets[0];                               /*设置待更新描述符所属的描述符集*/
+    descriptorWrite.dstBinding = 0;                                             /*设置该描述符集绑定的shader对应索引*/
+    descriptorWrite.dstArrayElement = 0;                                        /*设置目标描述符所在数组中的索引*/
+    descriptorWrite.descriptorType = vk::DescriptorType::eUniformBufferDynamic; /*设置描述符类型*/
+    descriptorWrite.descriptorCount = 1;                                        /*设置描述符数量*/
+    descriptorWrite.pBufferInfo = &bufferInfo;                                  /*设置描述符绑定的缓冲信息*/
+    VkBase::self().device.updateDescriptorSets(descriptorWrite, nullptr);
+    invalidate();   /*更新已绑定的描述符集会使录制过的命令缓冲失效*/
 }
 
 
 void Renderer::drawFrame()
 {
     auto& base_instance = VkBase::self(); 
-    if(base_instance.device.waitForFences(m_inflightFences[m_currentFrame], false, std::numeric_limits<uint64_t>::max())!=vk::Result::eSuccess)
-        std::cout << "Waiting for signal fences error!" << std::endl;
-    base_instance.device.resetFences(m_inflightFences[m_currentFrame]);
+    if(!base_instance.graphicsTimeline->wait(m_inflightValues[m_currentFrame]))
+        std::cout << "Waiting for frame timeline error!" << std::endl;
+    /*该槽位上一帧从开始录制到GPU完成的时间（in-flight帧越多，排队越长）*/
+    auto now = std::chrono::steady_clock::now();
+    if(m_inflightValues[m_currentFrame]>0)
+    {
+        double latency = std::chrono::duration<double, std::milli>(now-m_frameStartTimes[m_currentFrame]).count();
+        m_latencyMs = m_latencyMs>0.0 ? m_latencyMs*0.9 + latency*0.1 : latency;
+    }
+    m_frameStartTimes[m_currentFrame] = now;
+    /*回收已完成帧的延迟销毁对象，整池复位该槽位的命令缓冲*/
+    updateCompletedFrame();
+    base_instance.commandManager->beginFrame(m_currentFrame);
+    base_instance.parallelRecorder->beginFrame(m_currentFrame);
+    base_instance.deletionQueue->collect(m_completedFrame);
+    base_instance.allocator->invalidateMappedRanges();
+    base_instance.readback->update();   /*兑现已完成帧上的回读*/
+    base_instance.defragmenter->update(m_frameNumber, m_completedFrame);
+    base_instance.allocator->newFrame();
 
     /*1.从交换链获取一张图像*/
     auto res = base_instance.device.acquireNextImageKHR(base_instance.swapchain->swapchain, std::numeric_limits<uint64_t>::max(), m_imageAvailbleSemaphores[m_currentFrame]);
@@ -66,26 +101,83 @@ void Renderer::drawFrame()
     if(res.result != vk::Result::eSuccess && res.result != vk::Result::eSuboptimalKHR)
         throw std::runtime_error("[ Swapchian ]: Can't acquire next image from swapchian!");
     m_imageIndex = res.value;
+    m_inflightFrameNumbers[m_currentFrame] = ++m_frameNumber;
+    /*获取到的图像可能仍被另一槽位的帧使用（in-flight帧数多于交换链图像数，或显示引擎乱序返回图像）*/
+    trackSwapchainImages();
+    if(!base_instance.graphicsTimeline->wait(m_imageInflightValues[m_imageIndex]))
+        std::cout << "Waiting for swapchain image timeline error!" << std::endl;
 
-    /*2.记录命令到命令缓冲*/
-    m_commandbuffers[m_currentFrame].reset();
-    recordCommandBuffer(m_commandbuffers[m_currentFrame], m_imageIndex);
-    
-    /*3.更新MVP矩阵*/
-    base_instance.updateUniformBuffers(m_currentFrame);
+    /*2.上传顶点/索引数组的脏区间和本帧预算内的排队上传，提交本帧之前请求的数据上传，回收该帧的uniform环形缓冲区段并更新MVP矩阵*/
+    base_instance.vertexBuffer->upload();
+    base_instance.indexBuffer->upload();
+    if(base_instance.spriteScene)
+        base_instance.spriteScene->upload();
+    base_instance.uploadScheduler->update();
+    base_instance.stagingBelt->flush();
+    if(base_instance.transferCommander)
+        m_handoff = base_instance.transferCommander->takeHandoff();     /*接收专用传输队列上已提交的上传*/
+    base_instance.uniformRing->beginFrame(m_currentFrame);
+    m_uniformOffset = base_instance.updateUniformBuffers();
+    base_instance.spriteBatch->begin(m_currentFrame);   /*精灵顶点写入本帧的顶点流区段，投影矩阵写入uniform环*/
+    if(base_instance.spriteBenchmark)
+        base_instance.spriteBenchmark->update(*base_instance.spriteBatch, *base_instance.texture);
+    base_instance.spriteBatch->end();
+    base_instance.uniformRing->flush();
+    base_instance.allocator->flushMappedRanges();   /*非一致内存的写入在提交前统一flush*/
 
-    /*4.提交命令缓冲*/
-    vk::SubmitInfo submitInfo = {};
+    /*3.记录命令：所有权获取/mip生成和回读拷贝每帧不同，录制在槽位命令池的瞬时命令缓冲中（无需单独复位）；
+        渲染流程在场景不变时重放缓存的命令缓冲，精灵批处理的顶点每帧重新生成，有精灵时直接录制*/
+    std::vector<vk::CommandBuffer> commandBuffers;
+    if(!m_handoff.acquireBarriers.empty())
+    {
+        commandBuffers.push_back(base_instance.commandManager->allocateCommandBuffer());
+        recordHandoff(commandBuffers.back());
+    }
+    if(base_instance.spriteBatch->getSpriteCount()>0)
+    {
+        m_commandbuffers[m_currentFrame] = base_instance.commandManager->allocateCommandBuffer();
+        recordCommandBuffer(m_commandbuffers[m_currentFrame], m_imageIndex, vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    }
+    else
+        m_commandbuffers[m_currentFrame] = getCachedCommandBuffer(m_imageIndex);
+    commandBuffers.push_back(m_commandbuffers[m_currentFrame]);
+    if(base_instance.readback->hasQueued())
+    {
+        commandBuffers.push_back(base_instance.commandManager->allocateCommandBuffer());
+        recordReadback(commandBuffers.back(), m_imageIndex);
+    }
+
+    /*4.提交命令缓冲（二值信号量的等待/发出值被忽略）*/
+    std::vector<vk::Semaphore> waitSemaphores = { m_imageAvailbleSemaphores[m_currentFrame] };
+    std::vector<uint64_t> waitValues = { 0 };
     std::vector<vk::PipelineStageFlags>  waitPipelineStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-    submitInfo.setWaitSemaphores(m_imageAvailbleSemaphores[m_currentFrame])        /*设置该命令缓冲需要等待的信号量*/
+    if(m_handoff.value>0)
+    {
+        /*等待传输队列时间线到达本帧接收的上传，只阻塞片段着色阶段，顶点处理仍可与上传并行*/
+        waitSemaphores.push_back(m_handoff.timeline);
+        waitValues.push_back(m_handoff.value);
+        waitPipelineStages.push_back(vk::PipelineStageFlagBits::eFragmentShader);
+    }
+    m_inflightValues[m_currentFrame] = base_instance.graphicsTimeline->reserve();
+    m_imageInflightValues[m_imageIndex] = m_inflightValues[m_currentFrame];
+    base_instance.readback->submit(m_inflightValues[m_currentFrame]);
+    std::vector<vk::Semaphore> signalSemaphores = { m_renderFinishedSemaphores[m_imageIndex], base_instance.graphicsTimeline->getHandle() };
+    std::vector<uint64_t> signalValues = { 0, m_inflightValues[m_currentFrame] };
+    vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.setWaitSemaphoreValues(waitValues)
+                .setSignalSemaphoreValues(signalValues);
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.setPNext(&timelineInfo)
+              .setWaitSemaphores(waitSemaphores)        /*设置该命令缓冲需要等待的信号量*/
               .setWaitDstStageMask(waitPipelineStages)          /*设置需要等待管线到达指定阶段*/
-              .setCommandBuffers(m_commandbuffers[m_currentFrame])    /*设置待提交的命令缓冲*/
-              .setSignalSemaphores(m_renderFinishedSemaphores[m_currentFrame]);    /*设置命令缓冲执行完成后发出的信号量*/
-    base_instance.graphicsQueue.submit(submitInfo, m_inflightFences[m_currentFrame]);
+              .setCommandBuffers(commandBuffers)        /*设置待提交的命令缓冲（按顺序执行）*/
+              .setSignalSemaphores(signalSemaphores);    /*设置命令缓冲执行完成后发出的信号量（显示用二值信号量+图形队列时间线）*/
+    base_instance.graphicsQueue.submit(submitInfo);
+    m_handoff = QueueHandoff{};
 
     /*4.显示图像*/
     vk::PresentInfoKHR presentInfo = {};
-    presentInfo.setWaitSemaphores(m_renderFinishedSemaphores[m_currentFrame])  /*设置该命令缓冲需要等待的信号量*/
+    presentInfo.setWaitSemaphores(m_renderFinishedSemaphores[m_imageIndex])  /*设置该命令缓冲需要等待的信号量*/
                .setSwapchains(base_instance.swapchain->swapchain)         /*设置待显示图像所在的交换链*/
                .setImageIndices(m_imageIndex)                 /*设置待显示图像的索引*/
                .setPResults(nullptr);                       /*设置显示后的结果存储*/
@@ -102,47 +194,139 @@ vk::Result Renderer::getSwapchainState()
 }
 
 
-std::vector<vk::CommandBuffer> Renderer::createCommandBuffers()
+std::vector<vk::DescriptorSet> Renderer::createDescriptorSets()
 {
-    return VkBase::self().commandManager->allocateCommandBuffers(m_flightCount);
+    return VkBase::self().descriptorManager->allocateDescriptorSets(1);
 }
 
-std::vector<vk::DescriptorSet> Renderer::createDescriptorSets()
+
+bool Renderer::isFrameComplete(uint64_t frame)
 {
-    return VkBase::self().descriptorManager->allocateDescriptorSets(m_flightCount);
+    if(frame<=m_completedFrame)
+        return true;
+    if(frame>m_frameNumber)
+        return false;
+    updateCompletedFrame();
+    return frame<=m_completedFrame;
 }
 
-
-void Renderer::initFences()
+void Renderer::updateCompletedFrame()
 {
-    m_inflightFences.resize(m_flightCount);
-    vk::FenceCreateInfo createInfo = {};
-    createInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);    /*初始化fence时置位信号*/
-    for(auto& e : m_inflightFences)
-        e = VkBase::self().device.createFence(createInfo);
+    /*时间线值按提交顺序递增：查询一次计数值即可确定所有in-flight槽位中已完成的帧*/
+    uint64_t completedValue = VkBase::self().graphicsTimeline->getCompletedValue();
+    for(int i=0; i<maxFlightCount; i++)
+    {
+        if(m_inflightValues[i]<=completedValue)
+            m_completedFrame = std::max(m_completedFrame, m_inflightFrameNumbers[i]);
+    }
 }
 
 void Renderer::initSemaphores()
 {
-    m_imageAvailbleSemaphores.resize(m_flightCount);
-    m_renderFinishedSemaphores.resize(m_flightCount);
-    vk::SemaphoreCreateInfo createInfo = {};
-    for(int i=0; i<m_flightCount; i++)
+    m_imageAvailbleSemaphores.resize(maxFlightCount);
+    for(int i=0; i<maxFlightCount; i++)
+        m_imageAvailbleSemaphores[i] = VkBase::self().syncPool->acquireSemaphore();
+}
+
+void Renderer::trackSwapchainImages()
+{
+    /*重建后的交换链图像可能更多：按需补充每张图像的完成信号量和占用记录（只增不减）*/
+    size_t imageCount = VkBase::self().swapchain->images.size();
+    while(m_renderFinishedSemaphores.size()<imageCount)
+        m_renderFinishedSemaphores.push_back(VkBase::self().syncPool->acquireSemaphore());
+    if(m_imageInflightValues.size()<imageCount)
+        m_imageInflightValues.resize(imageCount, 0);
+    for(auto& cached : m_cachedCommandBuffers)
+    {
+        if(cached.size()<imageCount)
+            cached.resize(imageCount, CachedCommandBuffer{nullptr, 0, {}});
+    }
+}
+
+Renderer::RecordKey Renderer::currentRecordKey()
+{
+    auto& base_instance = VkBase::self();
+    RecordKey key = {};
+    key.vertexBuffer = base_instance.vertexBuffer->getBuffer();
+    key.vertexAddress = base_instance.vertexBuffer->getDeviceAddress();
+    key.indexBuffer = base_instance.indexBuffer->getBuffer();
+    key.indexCount = static_cast<uint32_t>(base_instance.indexBuffer->size());
+    key.uniformOffset = m_uniformOffset;
+    key.spriteUniformOffset = base_instance.spriteBatch->getUniformOffset();
+    key.spriteQuad = base_instance.spriteBatch->getQuadBuffer();
+    key.spriteIndices = base_instance.spriteBatch->getIndexBuffer();
+    key.sceneVersion = base_instance.spriteScene ? base_instance.spriteScene->getVersion() : 0;
+    return key;
+}
+
+vk::CommandBuffer Renderer::getCachedCommandBuffer(uint32_t imageIndex)
+{
+    /*按（槽位，交换链图像）缓存：同一槽位上一次提交已在帧开始时等待完成，复位重录不需要eSimultaneousUse*/
+    CachedCommandBuffer& cached = m_cachedCommandBuffers[m_currentFrame][imageIndex];
+    RecordKey key = currentRecordKey();
+    if(cached.commandBuffer && cached.version==m_recordVersion && cached.key==key)
+        return cached.commandBuffer;
+    if(!cached.commandBuffer)
     {
-        m_imageAvailbleSemaphores[i] = VkBase::self().device.createSemaphore(createInfo);
-        m_renderFinishedSemaphores[i] = VkBase::self().device.createSemaphore(createInfo);
+        vk::CommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.setCommandPool(m_cachePool)
+                    .setLevel(vk::CommandBufferLevel::ePrimary)
+                    .setCommandBufferCount(1);
+        cached.commandBuffer = VkBase::self().device.allocateCommandBuffers(allocateInfo)[0];
+        objectCounters().commandBuffers++;
     }
+    else
+        cached.commandBuffer.reset();
+    recordCommandBuffer(cached.commandBuffer, imageIndex, vk::CommandBufferUsageFlags{});
+    cached.version = m_recordVersion;
+    cached.key = key;
+    return cached.commandBuffer;
 }
 
-void Renderer::recordCommandBuffer(vk::CommandBuffer& commandBuffer, uint32_t imageIndex)
+void Renderer::recordHandoff(vk::CommandBuffer commandBuffer)
+{
+    auto& base_instance = VkBase::self();
+    vk::CommandBufferBeginInfo cbBeginInfo = {};
+    cbBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    commandBuffer.begin(cbBeginInfo);
+    /*获取专用传输队列释放的图像所有权（等待信号量的阶段与屏障源阶段一致）*/
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags(0),
+                                  nullptr, nullptr, m_handoff.acquireBarriers);
+    for(auto& barrier : m_handoff.acquireBarriers)
+    {
+        base_instance.resourceTracker->assume(barrier.image, ResourceUse::eFragmentSampled);
+        /*blit需要图形队列：获取所有权后在渲染流程之前生成mip链（其余层级丢弃旧内容，无需转移所有权）*/
+        if(base_instance.mipmapGenerator->isPending(barrier.image))
+            base_instance.mipmapGenerator->record(commandBuffer, barrier.image);
+    }
+    commandBuffer.end();
+}
+
+void Renderer::recordReadback(vk::CommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    auto& base_instance = VkBase::self();
+    vk::CommandBufferBeginInfo cbBeginInfo = {};
+    cbBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    commandBuffer.begin(cbBeginInfo);
+    /*在渲染流程所在命令缓冲之后提交：录制排队的回读拷贝（截图读取本帧的交换链图像）*/
+    base_instance.readback->record(commandBuffer, base_instance.swapchain->images[imageIndex].image);
+    commandBuffer.end();
+}
+
+void Renderer::recordCommandBuffer(vk::CommandBuffer commandBuffer, uint32_t imageIndex, vk::CommandBufferUsageFlags usage)
 {
     auto& base_instance = VkBase::self(); 
-    /*开始命令缓冲*/
+    m_recordCount++;
+    /*开始命令缓冲（缓存的命令缓冲可多次提交，不设置eOneTimeSubmit）*/
     vk::CommandBufferBeginInfo cbBeginInfo = {};
-    cbBeginInfo.setFlags(vk::CommandBufferUsageFlagBits::eSimultaneousUse)  /*设置命令缓冲使用方法为可同时提交*/
+    cbBeginInfo.setFlags(usage)
                .setPInheritanceInfo(nullptr);
     commandBuffer.begin(cbBeginInfo);
 
+    /*GPU剔除生成本帧的间接绘制命令（计算着色器需在渲染流程之外）*/
+    if(base_instance.spriteScene)
+        base_instance.spriteScene->cull(commandBuffer, m_currentFrame);
+
     /*设置渲染过程开始信息*/
     vk::ClearValue clearColor;
     clearColor.setColor(vk::ClearColorValue(std::array<float,4>{0.0, 0.0, 0.0, 1}));
@@ -152,35 +336,106 @@ void Renderer::recordCommandBuffer(vk::CommandBuffer& commandBuffer, uint32_t im
                  .setRenderArea(vk::Rect2D({0,0}, base_instance.swapchain->getExtent()))  /*设置渲染区域*/
                  .setClearValues(clearColor);                                             /*设置VK_ATTACHMENT_LOAD_OP_CLEAR渲染前清屏值*/
 
-    /*渲染过程*/
-    commandBuffer.beginRenderPass(passBeginInfo, vk::SubpassContents::eInline); /*设置如何提供命令（是否有辅助命令缓冲）*/
+    /*渲染过程：批次很多时各线程把绘制录制到辅助命令缓冲（只用于本帧的瞬时命令缓冲，缓存的命令缓冲不能引用每帧复位的辅助命令缓冲）*/
+    bool parallel = (usage & vk::CommandBufferUsageFlagBits::eOneTimeSubmit) && base_instance.parallelRecorder->getThreadCount()>1
+                    && base_instance.spriteBatch->getDrawCount()>=parallelBatchThreshold;
+    if(parallel)
+    {
+        commandBuffer.beginRenderPass(passBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+        recordParallel(commandBuffer, imageIndex);
+    }
+    else
+    {
+        commandBuffer.beginRenderPass(passBeginInfo, vk::SubpassContents::eInline); /*设置如何提供命令（是否有辅助命令缓冲）*/
+        recordMesh(commandBuffer);
+        /*绘制精灵批次（与主管线共用set 0的uniform描述符集）*/
+        base_instance.spriteBatch->record(commandBuffer, m_descriptorSets[0]);
+        if(base_instance.spriteScene)
+            base_instance.spriteScene->record(commandBuffer, m_descriptorSets[0]);
+    }
+    commandBuffer.endRenderPass();
+
+    /*结束命令缓冲*/
+    commandBuffer.end();
+}
+
+void Renderer::recordParallel(vk::CommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    auto& base_instance = VkBase::self();
+    /*1.划分任务：主网格、若干段连续的精灵批次、GPU驱动的精灵场景，按绘制顺序排列*/
+    auto& spriteBatch = *base_instance.spriteBatch;
+    uint32_t drawCount = spriteBatch.getDrawCount();
+    uint32_t chunkCount = std::clamp(drawCount/minBatchesPerTask, 1u, base_instance.parallelRecorder->getThreadCount()*2);
+    uint32_t chunkSize = (drawCount+chunkCount-1) / chunkCount;
+    std::vector<ParallelRecorder::Task> tasks;
+    tasks.push_back([this](vk::CommandBuffer cmdBuffer){ recordMesh(cmdBuffer); });
+    for(uint32_t first=0; first<drawCount; first+=chunkSize)
+    {
+        tasks.push_back([this, &spriteBatch, first, chunkSize](vk::CommandBuffer cmdBuffer){
+            setViewport(cmdBuffer);     /*动态状态不从主命令缓冲继承*/
+            spriteBatch.record(cmdBuffer, m_descriptorSets[0], first, chunkSize);
+        });
+    }
+    if(base_instance.spriteScene)
+    {
+        tasks.push_back([this](vk::CommandBuffer cmdBuffer){
+            setViewport(cmdBuffer);
+            VkBase::self().spriteScene->record(cmdBuffer, m_descriptorSets[0]);
+        });
+    }
+
+    /*2.并行录制辅助命令缓冲（继承渲染流程的第0个子流程和本帧的framebuffer），按任务顺序执行*/
+    vk::CommandBufferInheritanceInfo inheritance = {};
+    inheritance.setRenderPass(base_instance.renderProcess->renderPass)
+               .setSubpass(0)
+               .setFramebuffer(base_instance.swapchain->framebuffers[imageIndex]);
+    std::vector<vk::CommandBuffer> secondaries = base_instance.parallelRecorder->record(inheritance, tasks);
+    commandBuffer.executeCommands(secondaries);
+}
+
+void Renderer::setViewport(vk::CommandBuffer commandBuffer)
+{
+    auto& base_instance = VkBase::self();
+    vk::Viewport viewport = {};
+    viewport.setX(0).setY(0)
+            .setWidth(base_instance.swapchain->getExtent().width).setHeight(base_instance.swapchain->getExtent().height)
+            .setMinDepth(0.0).setMaxDepth(1.0);
+    commandBuffer.setViewport(0, viewport);
+    vk::Rect2D scissor = {};
+    scissor.setOffset({0, 0}).setExtent(base_instance.swapchain->getExtent());
+    commandBuffer.setScissor(0, scissor);
+}
+
+void Renderer::recordMesh(vk::CommandBuffer commandBuffer)
+{
+    auto& base_instance = VkBase::self();
+    if(base_instance.renderProcess->graphicsPipeline_pull)
+    {
+        /*顶点拉取：无需绑定顶点缓冲，顶点数据地址通过push constant传入*/
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, base_instance.renderProcess->graphicsPipeline_pull);
+        VertexPullConstants constants = {};
+        constants.vertices = base_instance.vertexBuffer->getDeviceAddress();
+        constants.stride = sizeof(Vertex) / sizeof(float);
+        constants.colorOffset = offsetof(Vertex, color) / sizeof(float);
+        commandBuffer.pushConstants(base_instance.renderProcess->pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(constants), &constants);
+    }
+    else
     {
         /*绑定渲染管线*/
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, base_instance.renderProcess->graphicsPipeline_triangle);
         /*绑定顶点缓冲*/
-        std::vector<vk::Buffer> buffers = { base_instance.vertexBuffer->buffer };  
+        std::vector<vk::Buffer> buffers = { base_instance.vertexBuffer->getBuffer() };  
         std::vector<vk::DeviceSize> offsets = {0};
         commandBuffer.bindVertexBuffers(0, buffers, offsets);
-        /*绑定顶点索引*/
-        commandBuffer.bindIndexBuffer(base_instance.indexBuffer->buffer, 0, vk::IndexType::eUint16);
-        /*绑定uniform变量*/
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, base_instance.renderProcess->pipelineLayout, 0, base_instance.renderer->getDescriptorSets()[m_currentFrame], {});
-        /*重新设置一下视口和裁剪*/
-        vk::Viewport viewport = {};
-        viewport.setX(0).setY(0)
-                .setWidth(base_instance.swapchain->getExtent().width).setHeight(base_instance.swapchain->getExtent().height)
-                .setMinDepth(0.0).setMaxDepth(1.0);
-        commandBuffer.setViewport(0, viewport);
-        vk::Rect2D scissor = {};
-        scissor.setOffset({0, 0}).setExtent(base_instance.swapchain->getExtent());
-        commandBuffer.setScissor(0, scissor);
-        /*绘制*/
-        commandBuffer.drawIndexed(indices.size(), 1, 0, 0, 0);
     }
-    commandBuffer.endRenderPass();
-
-    /*结束命令缓冲*/
-    commandBuffer.end();
+    /*绑定顶点索引*/
+    commandBuffer.bindIndexBuffer(base_instance.indexBuffer->getBuffer(), 0, vk::IndexType::eUint16);
+    /*绑定uniform变量*/
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, base_instance.renderProcess->pipelineLayout, 0, m_descriptorSets[0], m_uniformOffset);
+    /*重新设置一下视口和裁剪*/
+    setViewport(commandBuffer);
+    /*绘制*/
+    commandBuffer.drawIndexed(base_instance.indexBuffer->size(), 1, 0, 0, 0);
 }
 
 
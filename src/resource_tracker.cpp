@@ -0,0 +1,219 @@
+#include "resource_tracker.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+/*会修改资源内容的访问类型*/
+static const vk::AccessFlags2 writeAccessMask = vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eShaderWrite |
+                                                vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eColorAttachmentWrite |
+                                                vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eHostWrite |
+                                                vk::AccessFlagBits2::eMemoryWrite;
+
+ResourceTracker::ResourceTracker() : m_barrierCount(0)
+{
+}
+
+ResourceTracker::~ResourceTracker()
+{
+}
+
+ResourceState ResourceTracker::stateOf(ResourceUse use)
+{
+    using Stage = vk::PipelineStageFlagBits2;
+    using Access = vk::AccessFlagBits2;
+    using Layout = vk::ImageLayout;
+    switch(use)
+    {
+        case ResourceUse::eUndefined:         return {Stage::eNone, Access::eNone, Layout::eUndefined};
+        case ResourceUse::eTransferSrc:       return {Stage::eTransfer, Access::eTransferRead, Layout::eTransferSrcOptimal};
+        case ResourceUse::eTransferDst:       return {Stage::eTransfer, Access::eTransferWrite, Layout::eTransferDstOptimal};
+        case ResourceUse::eVertexBuffer:      return {Stage::eVertexAttributeInput, Access::eVertexAttributeRead, Layout::eUndefined};
+        case ResourceUse::eIndexBuffer:       return {Stage::eIndexInput, Access::eIndexRead, Layout::eUndefined};
+        case ResourceUse::eIndirectBuffer:    return {Stage::eDrawIndirect, Access::eIndirectCommandRead, Layout::eUndefined};
+        case ResourceUse::eUniformBuffer:     return {Stage::eVertexShader|Stage::eFragmentShader, Access::eUniformRead, Layout::eUndefined};
+        case ResourceUse::eVertexShaderRead:  return {Stage::eVertexShader, Access::eShaderStorageRead, Layout::eUndefined};
+        case ResourceUse::eFragmentSampled:   return {Stage::eFragmentShader, Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal};
+        case ResourceUse::eComputeSampled:    return {Stage::eComputeShader, Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal};
+        case ResourceUse::eComputeRead:       return {Stage::eComputeShader, Access::eShaderStorageRead, Layout::eGeneral};
+        case ResourceUse::eComputeWrite:      return {Stage::eComputeShader, Access::eShaderStorageWrite, Layout::eGeneral};
+        case ResourceUse::eComputeReadWrite:  return {Stage::eComputeShader, Access::eShaderStorageRead|Access::eShaderStorageWrite, Layout::eGeneral};
+        case ResourceUse::eColorAttachment:   return {Stage::eColorAttachmentOutput, Access::eColorAttachmentRead|Access::eColorAttachmentWrite, Layout::eColorAttachmentOptimal};
+        case ResourceUse::ePresent:           return {Stage::eNone, Access::eNone, Layout::ePresentSrcKHR};
+        case ResourceUse::eHostRead:          return {Stage::eHost, Access::eHostRead, Layout::eGeneral};
+    }
+    throw std::runtime_error("[ ResourceTracker ]: Unknown resource use!");
+}
+
+ResourceState ResourceTracker::stateOf(vk::ImageLayout layout)
+{
+    /*只知道布局时按该布局的典型用法推断（可能偏保守）*/
+    switch(layout)
+    {
+        case vk::ImageLayout::eUndefined:               return stateOf(ResourceUse::eUndefined);
+        case vk::ImageLayout::eTransferSrcOptimal:      return stateOf(ResourceUse::eTransferSrc);
+        case vk::ImageLayout::eTransferDstOptimal:      return stateOf(ResourceUse::eTransferDst);
+        case vk::ImageLayout::eShaderReadOnlyOptimal:   return {vk::PipelineStageFlagBits2::eFragmentShader|vk::PipelineStageFlagBits2::eComputeShader,
+                                                                vk::AccessFlagBits2::eShaderSampledRead, layout};
+        case vk::ImageLayout::eGeneral:                 return stateOf(ResourceUse::eComputeReadWrite);
+        case vk::ImageLayout::eColorAttachmentOptimal:  return stateOf(ResourceUse::eColorAttachment);
+        case vk::ImageLayout::ePresentSrcKHR:           return stateOf(ResourceUse::ePresent);
+        default:                                        return {vk::PipelineStageFlagBits2::eAllCommands,
+                                                                vk::AccessFlagBits2::eMemoryRead|vk::AccessFlagBits2::eMemoryWrite, layout};
+    }
+}
+
+void ResourceTracker::registerImage(vk::Image image, uint32_t mipLevels, vk::ImageAspectFlags aspect)
+{
+    TrackedImage& tracked = m_images[static_cast<VkImage>(image)];
+    tracked.aspect = aspect;
+    tracked.levels.assign(mipLevels, TrackedState{vk::ImageLayout::eUndefined});
+}
+
+void ResourceTracker::forget(vk::Image image)
+{
+    m_images.erase(static_cast<VkImage>(image));
+}
+
+void ResourceTracker::forget(vk::Buffer buffer)
+{
+    m_buffers.erase(static_cast<VkBuffer>(buffer));
+}
+
+void ResourceTracker::assume(vk::Image image, ResourceUse use)
+{
+    /*资源已由外部同步（如队列族所有权获取屏障）到达该状态，直接记录而不生成屏障*/
+    auto it = m_images.find(static_cast<VkImage>(image));
+    if(it==m_images.end())
+        throw std::runtime_error("[ ResourceTracker ]: Image is not registered!");
+    ResourceState state = stateOf(use);
+    for(auto& level : it->second.levels)
+        level = {state.layout, state.stage, vk::AccessFlags2{}, vk::PipelineStageFlags2{}, state.stage, state.access};
+}
+
+void ResourceTracker::assume(vk::Buffer buffer, ResourceUse use)
+{
+    /*缓冲的上一次使用不在当前的录制顺序中（如重放的缓存命令缓冲、暂存环的拷贝），按该用途记录：
+      之后的写入据此等待，写入用途的内容对其它阶段或访问类型的读取仍需屏障*/
+    ResourceState state = stateOf(use);
+    m_buffers[static_cast<VkBuffer>(buffer)] = {vk::ImageLayout::eUndefined, state.stage, state.access & writeAccessMask, vk::PipelineStageFlags2{}, state.stage, state.access};
+}
+
+vk::ImageLayout ResourceTracker::getLayout(vk::Image image, uint32_t mipLevel) const
+{
+    auto it = m_images.find(static_cast<VkImage>(image));
+    if(it==m_images.end())
+        return vk::ImageLayout::eUndefined;
+    return it->second.levels[mipLevel].layout;
+}
+
+bool ResourceTracker::transition(TrackedState& state, const ResourceState& next, bool discard, Transition& out)
+{
+    bool write = bool(next.access & writeAccessMask) || next.layout!=state.layout;
+    if(write)
+    {
+        /*写入（含布局变换）：等待之前的写入和读取全部完成，之前的写入对本次访问可见*/
+        out.srcStage = state.writeStages | state.readStages;
+        out.srcAccess = state.writeAccess;
+        out.oldLayout = discard ? vk::ImageLayout::eUndefined : state.layout;
+        bool needed = bool(out.srcStage) || next.layout!=state.layout;
+        state = {next.layout, next.stage, next.access & writeAccessMask, vk::PipelineStageFlags2{}, next.stage, next.access};
+        return needed;
+    }
+    /*读取：读后读无需屏障，最近的写入已对该阶段和访问类型可见时也无需屏障*/
+    state.readStages |= next.stage;
+    bool visible = (state.visibleStages & next.stage)==next.stage && (state.visibleAccess & next.access)==next.access;
+    if(!state.writeStages || visible)
+        return false;
+    out.srcStage = state.writeStages;
+    out.srcAccess = state.writeAccess;
+    out.oldLayout = state.layout;
+    state.visibleStages |= next.stage;
+    state.visibleAccess |= next.access;
+    return true;
+}
+
+void ResourceTracker::useImage(vk::Image image, ResourceUse use, uint32_t baseMipLevel, uint32_t levelCount, bool discard)
+{
+    auto it = m_images.find(static_cast<VkImage>(image));
+    if(it==m_images.end())
+        throw std::runtime_error("[ ResourceTracker ]: Image is not registered!");
+    TrackedImage& tracked = it->second;
+    uint32_t endLevel = levelCount==VK_REMAINING_MIP_LEVELS ? static_cast<uint32_t>(tracked.levels.size()) : baseMipLevel+levelCount;
+    ResourceState next = stateOf(use);
+    for(uint32_t level=baseMipLevel; level<endLevel; level++)
+    {
+        Transition t = {};
+        if(!transition(tracked.levels[level], next, discard, t))
+            continue;
+        /*相邻mip层级的屏障参数相同时合并为一个屏障*/
+        if(!m_imageBarriers.empty())
+        {
+            auto& last = m_imageBarriers.back();
+            if(last.image==image && last.subresourceRange.baseMipLevel+last.subresourceRange.levelCount==level &&
+               last.srcStageMask==t.srcStage && last.srcAccessMask==t.srcAccess && last.oldLayout==t.oldLayout &&
+               last.dstStageMask==next.stage && last.dstAccessMask==next.access && last.newLayout==next.layout)
+            {
+                last.subresourceRange.levelCount++;
+                continue;
+            }
+        }
+        vk::ImageSubresourceRange subresourceRange;
+        subresourceRange.setAspectMask(tracked.aspect)
+                        .setBaseMipLevel(level).setLevelCount(1)
+                        .setBaseArrayLayer(0).setLayerCount(1);
+        vk::ImageMemoryBarrier2 barrier = {};
+        barrier.setSrcStageMask(t.srcStage)                     /*等待之前访问所在的阶段*/
+               .setSrcAccessMask(t.srcAccess)                   /*需要刷新的之前写入*/
+               .setDstStageMask(next.stage)                     /*本次访问所在的阶段*/
+               .setDstAccessMask(next.access)                   /*本次访问类型*/
+               .setOldLayout(t.oldLayout)
+               .setNewLayout(next.layout)
+               .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)  /*不转移队列族所有权*/
+               .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+               .setImage(image)
+               .setSubresourceRange(subresourceRange);
+        m_imageBarriers.push_back(barrier);
+        m_barrierCount++;
+    }
+}
+
+void ResourceTracker::useBuffer(vk::Buffer buffer, ResourceUse use)
+{
+    /*缓冲首次使用时自动开始跟踪*/
+    TrackedState& state = m_buffers.try_emplace(static_cast<VkBuffer>(buffer), TrackedState{vk::ImageLayout::eUndefined}).first->second;
+    ResourceState next = stateOf(use);
+    next.layout = vk::ImageLayout::eUndefined;
+    Transition t = {};
+    if(!transition(state, next, false, t))
+        return;
+    vk::BufferMemoryBarrier2 barrier = {};
+    barrier.setSrcStageMask(t.srcStage)
+           .setSrcAccessMask(t.srcAccess)
+           .setDstStageMask(next.stage)
+           .setDstAccessMask(next.access)
+           .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+           .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+           .setBuffer(buffer)
+           .setOffset(0)
+           .setSize(VK_WHOLE_SIZE);
+    m_bufferBarriers.push_back(barrier);
+    m_barrierCount++;
+}
+
+void ResourceTracker::flush(vk::CommandBuffer cmdBuffer)
+{
+    /*同一使用点累积的所有屏障一次提交*/
+    if(!hasPendingBarriers())
+        return;
+    vk::DependencyInfo dependencyInfo = {};
+    dependencyInfo.setImageMemoryBarriers(m_imageBarriers)
+                  .setBufferMemoryBarriers(m_bufferBarriers);
+    cmdBuffer.pipelineBarrier2(dependencyInfo);
+    m_imageBarriers.clear();
+    m_bufferBarriers.clear();
+}
+
+
+
+}
@@ -0,0 +1,50 @@
+#include "ring_buffer.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+RingBuffer::RingBuffer(vk::BufferUsageFlags usage, vk::DeviceSize frameSize, uint32_t frameCount, vk::DeviceSize alignment)
+    : m_alignment(alignment), m_frameBegin(0), m_head(0), m_frameCount(frameCount)
+{
+    /*每帧区段大小向上对齐，保证每段起始位置满足对齐要求*/
+    m_frameSize = (frameSize + m_alignment - 1) / m_alignment * m_alignment;
+    m_buffer = std::make_unique<Buffer>(usage, m_frameSize*m_frameCount, MemoryUsage::eDynamic);
+}
+
+RingBuffer::~RingBuffer()
+{
+    m_buffer.reset();
+}
+
+void RingBuffer::beginFrame(uint32_t frameIndex)
+{
+    /*调用前图形队列时间线已到达该帧的值，GPU不再读取该段数据*/
+    m_frameBegin = (frameIndex % m_frameCount) * m_frameSize;
+    m_head = m_frameBegin;
+}
+
+void RingBuffer::flush()
+{
+    /*本帧写入的区段是连续的，提交前整体flush一次*/
+    if(m_head > m_frameBegin)
+        m_buffer->flush(m_frameBegin, m_head-m_frameBegin);
+}
+
+RingAllocation RingBuffer::allocate(vk::DeviceSize size)
+{
+    vk::DeviceSize offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+    if(offset + size > m_frameBegin + m_frameSize)
+        throw std::runtime_error("[ RingBuffer ]: Per-frame ring segment overflow!");
+    m_head = offset + size;
+
+    RingAllocation alloc = {};
+    alloc.buffer = m_buffer->buffer;
+    alloc.offset = static_cast<uint32_t>(offset);
+    alloc.data = static_cast<char*>(m_buffer->data) + offset;
+    return alloc;
+}
+
+
+
+}
@@ -5,7 +5,8 @@
 
 namespace vulkan2d{
 
-Shader::Shader(const std::vector<char>& vertexSource, const std::vector<char>& fragmentSource)
+Shader::Shader(const std::vector<char>& vertexSource, const std::vector<char>& fragmentSource,
+               const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& setBindings)
 {
     /*1.创建着色器模组*/
     vk::ShaderModuleCreateInfo vertex_createInfo = {}; 
@@ -20,7 +21,7 @@ Shader::Shader(const std::vector<char>& vertexSource, const std::vector<char>& f
     m_fragmentModule = VkBase::self().device.createShaderModule(fragment_createInfo);
     
     /*2.初始化描述符集布局*/
-    initDescriptorSetLayout();
+    initDescriptorSetLayout(setBindings);
 }
 
 Shader::~Shader()
@@ -32,16 +33,25 @@ Shader::~Shader()
     VkBase::self().device.destroyShaderModule(m_vertexModule);
 }
 
-void Shader::initDescriptorSetLayout()
+void Shader::initDescriptorSetLayout(const std::vector<std::vector<vk::DescriptorSetLayoutBinding>>& setBindings)
 {
-    vk::DescriptorSetLayoutCreateInfo createInfo = {};
-    vk::DescriptorSetLayoutBinding binding = {};
-    binding.setBinding(0)
-           .setDescriptorCount(1)
-           .setDescriptorType(vk::DescriptorType::eUniformBuffer)
-           .setStageFlags(vk::ShaderStageFlagBits::eVertex);
-    createInfo.setBindings(binding);
-    m_descriptorSetLayouts.push_back(VkBase::self().device.createDescriptorSetLayout(createInfo));
+    /*未指定时只有set 0：顶点着色器中的dynamic uniform缓冲*/
+    if(setBindings.empty())
+    {
+        vk::DescriptorSetLayoutBinding binding = {};
+        binding.setBinding(0)
+               .setDescriptorCount(1)
+               .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+               .setStageFlags(vk::ShaderStageFlagBits::eVertex);
+        initDescriptorSetLayout({{binding}});
+        return;
+    }
+    for(auto& bindings : setBindings)
+    {
+        vk::DescriptorSetLayoutCreateInfo createInfo = {};
+        createInfo.setBindings(bindings);
+        m_descriptorSetLayouts.push_back(VkBase::self().device.createDescriptorSetLayout(createInfo));
+    }
 }
 
 
@@ -0,0 +1,326 @@
+#include "sprite_batch.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+std::array<vk::VertexInputBindingDescription,1> SpriteVertex::getBindingDescriptions()
+{
+    std::array<vk::VertexInputBindingDescription,1> bindingDescriptions = {};
+    bindingDescriptions[0].setBinding(0)
+                          .setStride(sizeof(SpriteVertex))
+                          .setInputRate(vk::VertexInputRate::eVertex);
+    return bindingDescriptions;
+}
+
+std::array<vk::VertexInputAttributeDescription,3> SpriteVertex::getAttributeDescriptions()
+{
+    std::array<vk::VertexInputAttributeDescription,3> attributeDescriptions = {};
+    attributeDescriptions[0].setBinding(0)
+                            .setFormat(vk::Format::eR32G32Sfloat)       /*位置：vec2*/
+                            .setLocation(0)
+                            .setOffset(offsetof(SpriteVertex, pos));
+    attributeDescriptions[1].setBinding(0)
+                            .setFormat(vk::Format::eR16G16Unorm)        /*纹理坐标：归一化到[0,1]的16位整数*/
+                            .setLocation(1)
+                            .setOffset(offsetof(SpriteVertex, uv));
+    attributeDescriptions[2].setBinding(0)
+                            .setFormat(vk::Format::eR8G8B8A8Unorm)      /*颜色：归一化到[0,1]的8位整数*/
+                            .setLocation(2)
+                            .setOffset(offsetof(SpriteVertex, color));
+    return attributeDescriptions;
+}
+
+std::array<vk::VertexInputBindingDescription,2> SpriteInstance::getBindingDescriptions()
+{
+    std::array<vk::VertexInputBindingDescription,2> bindingDescriptions = {};
+    bindingDescriptions[0].setBinding(0)
+                          .setStride(sizeof(glm::vec2))
+                          .setInputRate(vk::VertexInputRate::eVertex);      /*单位四边形的角*/
+    bindingDescriptions[1].setBinding(1)
+                          .setStride(sizeof(SpriteInstance))
+                          .setInputRate(vk::VertexInputRate::eInstance);    /*每个实例前进一次*/
+    return bindingDescriptions;
+}
+
+std::array<vk::VertexInputAttributeDescription,6> SpriteInstance::getAttributeDescriptions()
+{
+    std::array<vk::VertexInputAttributeDescription,6> attributeDescriptions = {};
+    attributeDescriptions[0].setBinding(0)
+                            .setFormat(vk::Format::eR32G32Sfloat)       /*四边形角：vec2*/
+                            .setLocation(0)
+                            .setOffset(0);
+    attributeDescriptions[1].setBinding(1)
+                            .setFormat(vk::Format::eR32G32Sfloat)       /*中心位置：vec2*/
+                            .setLocation(1)
+                            .setOffset(offsetof(SpriteInstance, position));
+    attributeDescriptions[2].setBinding(1)
+                            .setFormat(vk::Format::eR32G32Sfloat)       /*尺寸：vec2*/
+                            .setLocation(2)
+                            .setOffset(offsetof(SpriteInstance, size));
+    attributeDescriptions[3].setBinding(1)
+                            .setFormat(vk::Format::eR32Sfloat)          /*旋转角：float*/
+                            .setLocation(3)
+                            .setOffset(offsetof(SpriteInstance, rotation));
+    attributeDescriptions[4].setBinding(1)
+                            .setFormat(vk::Format::eR16G16B16A16Unorm)  /*纹理区域：归一化到[0,1]的16位整数*/
+                            .setLocation(4)
+                            .setOffset(offsetof(SpriteInstance, uvRect));
+    attributeDescriptions[5].setBinding(1)
+                            .setFormat(vk::Format::eR8G8B8A8Unorm)      /*颜色：归一化到[0,1]的8位整数*/
+                            .setLocation(5)
+                            .setOffset(offsetof(SpriteInstance, color));
+    return attributeDescriptions;
+}
+
+uint32_t packColor(const glm::vec4& color)
+{
+    glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return uint32_t(c.r) | (uint32_t(c.g)<<8) | (uint32_t(c.b)<<16) | (uint32_t(c.a)<<24);
+}
+
+SpriteInstance makeInstance(const Sprite& sprite)
+{
+    SpriteInstance instance = {};
+    instance.position = sprite.position;
+    instance.size = sprite.size;
+    instance.rotation = sprite.rotation;
+    for(int i=0; i<4; i++)
+        instance.uvRect[i] = uint16_t(sprite.uvRect[i]*65535.0f);
+    instance.color = sprite.color;
+    return instance;
+}
+
+SpriteBatch::SpriteBatch(uint32_t maxSprites, SpriteMode mode)
+    : m_spriteCount(0), m_vertexBase(0), m_cursor(nullptr), m_chunkEnd(nullptr), m_mode(mode), m_nextMode(mode),
+      m_uniformOffset(0), m_lastView(nullptr), m_lastSet(nullptr)
+{
+    /*1.顶点流：每帧区段按整块向上取整，块与块首尾相接（按展开路径的大小分配，实例化路径只用其中一半）*/
+    m_maxSprites = (maxSprites + chunkSprites - 1) / chunkSprites * chunkSprites;
+    m_vertices = std::make_unique<RingBuffer>(vk::BufferUsageFlagBits::eVertexBuffer, vk::DeviceSize(m_maxSprites)*4*sizeof(SpriteVertex),
+                                              Renderer::maxFlightCount, sizeof(SpriteVertex));
+    /*2.静态索引：所有精灵共用，批次通过vertexOffset选择起始精灵（随初始化时的暂存环统一上传）*/
+    m_indices = std::make_unique<GpuVector<uint32_t>>(vk::BufferUsageFlagBits::eIndexBuffer, size_t(m_maxSprites)*6);
+    std::vector<uint32_t> indices(size_t(m_maxSprites)*6);
+    for(uint32_t i=0; i<m_maxSprites; i++)
+    {
+        uint32_t* quad = &indices[size_t(i)*6];
+        quad[0] = i*4+0; quad[1] = i*4+1; quad[2] = i*4+2;
+        quad[3] = i*4+2; quad[4] = i*4+3; quad[5] = i*4+0;
+    }
+    m_indices->assign(indices.begin(), indices.end());
+    m_indices->upload();
+    std::vector<glm::vec2> quad = { {-0.5f,-0.5f}, {-0.5f,0.5f}, {0.5f,0.5f}, {0.5f,-0.5f} };     /*与展开路径的角顺序相同，共用第一个精灵的6个索引*/
+    m_quad = std::make_unique<GpuVector<glm::vec2>>(vk::BufferUsageFlagBits::eVertexBuffer, quad.size());
+    m_quad->assign(quad.begin(), quad.end());
+    m_quad->upload();
+    /*3.纹理描述符集池（每个纹理视图一个集，纹理销毁时释放）*/
+    m_descriptorPools.push_back(createDescriptorPool());
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    for(auto& pool : m_descriptorPools)
+        VkBase::self().device.destroyDescriptorPool(pool);
+    m_quad.reset();
+    m_indices.reset();
+    m_vertices.reset();
+}
+
+void SpriteBatch::begin(uint32_t frameIndex)
+{
+    /*该帧槽位的GPU工作已完成，整段顶点区段可以覆盖*/
+    m_vertices->beginFrame(frameIndex);
+    m_mode = m_nextMode;
+    m_batches.clear();
+    m_spriteCount = 0;
+    m_cursor = m_chunkEnd = nullptr;
+    m_lastView = nullptr;
+    m_lastSet = nullptr;
+}
+
+void SpriteBatch::nextChunk()
+{
+    if(m_spriteCount>=m_maxSprites)
+        throw std::runtime_error("[ SpriteBatch ]: Too many sprites in one frame!");
+    RingAllocation alloc = m_vertices->allocate(chunkSprites*spriteBytes());
+    if(m_spriteCount==0)
+        m_vertexBase = alloc.offset;
+    m_cursor = static_cast<char*>(alloc.data);
+    m_chunkEnd = m_cursor + chunkSprites*spriteBytes();
+}
+
+void SpriteBatch::draw(const Texture& texture, const Sprite& sprite, BlendMode blend)
+{
+    if(m_cursor==m_chunkEnd)
+        nextChunk();
+    /*1.纹理或混合方式变化时开始新批次*/
+    if(texture.view!=m_lastView)
+    {
+        m_lastSet = getTextureSet(texture);
+        m_lastView = texture.view;
+    }
+    if(m_batches.empty() || m_batches.back().textureSet!=m_lastSet || m_batches.back().blend!=blend)
+        m_batches.push_back({m_lastSet, blend, m_spriteCount, 0});
+    m_batches.back().spriteCount++;
+    m_spriteCount++;
+
+    if(m_mode==SpriteMode::eInstanced)
+    {
+        /*实例化路径：只写一条实例记录，四个角由顶点着色器计算*/
+        *reinterpret_cast<SpriteInstance*>(m_cursor) = makeInstance(sprite);
+        m_cursor += sizeof(SpriteInstance);
+        return;
+    }
+
+    /*2.绕中心旋转后的四个角（左上、左下、右下、右上）*/
+    glm::vec2 half = sprite.size * 0.5f;
+    glm::vec2 axisX(half.x, 0.0f), axisY(0.0f, half.y);
+    if(sprite.rotation!=0.0f)
+    {
+        float c = std::cos(sprite.rotation), s = std::sin(sprite.rotation);
+        axisX = glm::vec2(c*half.x, s*half.x);
+        axisY = glm::vec2(-s*half.y, c*half.y);
+    }
+    uint16_t u0 = uint16_t(sprite.uvRect.x*65535.0f), v0 = uint16_t(sprite.uvRect.y*65535.0f);
+    uint16_t u1 = uint16_t(sprite.uvRect.z*65535.0f), v1 = uint16_t(sprite.uvRect.w*65535.0f);
+    SpriteVertex* v = reinterpret_cast<SpriteVertex*>(m_cursor);
+    v[0] = {sprite.position - axisX - axisY, {u0, v0}, sprite.color};
+    v[1] = {sprite.position - axisX + axisY, {u0, v1}, sprite.color};
+    v[2] = {sprite.position + axisX + axisY, {u1, v1}, sprite.color};
+    v[3] = {sprite.position + axisX - axisY, {u1, v0}, sprite.color};
+    m_cursor += 4*sizeof(SpriteVertex);
+}
+
+void SpriteBatch::end()
+{
+    /*写入的顶点在提交前flush，像素坐标的正交投影写入本帧uniform区段*/
+    m_vertices->flush();
+    auto& base_instance = VkBase::self();
+    vk::Extent2D extent = base_instance.swapchain->getExtent();
+    UniformBufferObject ubo = {};
+    ubo.model = glm::mat4(1.0f);
+    ubo.view = glm::mat4(1.0f);
+    ubo.proj = glm::ortho(0.0f, float(extent.width), 0.0f, float(extent.height), -1.0f, 1.0f);    /*Vulkan裁剪空间y向下：原点在左上角*/
+    m_uniformOffset = base_instance.uniformRing->push(ubo).offset;
+}
+
+void SpriteBatch::record(vk::CommandBuffer cmdBuffer, vk::DescriptorSet uniformSet, uint32_t firstBatch, uint32_t batchCount)
+{
+    /*在渲染流程内调用（视口和裁剪已设置）。只读取本帧的批次列表，不同的批次区间可由多个线程分别录制到各自的辅助命令缓冲*/
+    if(firstBatch>=m_batches.size())
+        return;
+    uint32_t lastBatch = static_cast<uint32_t>(std::min<size_t>(m_batches.size(), size_t(firstBatch)+batchCount));
+    auto& renderProcess = *VkBase::self().renderProcess;
+    bool instanced = m_mode==SpriteMode::eInstanced;
+    if(instanced)
+    {
+        std::array<vk::Buffer,2> buffers = { m_quad->getBuffer(), m_vertices->getBuffer() };
+        std::array<vk::DeviceSize,2> offsets = { 0, m_vertexBase };
+        cmdBuffer.bindVertexBuffers(0, buffers, offsets);
+    }
+    else
+        cmdBuffer.bindVertexBuffers(0, m_vertices->getBuffer(), m_vertexBase);
+    cmdBuffer.bindIndexBuffer(m_indices->getBuffer(), 0, vk::IndexType::eUint32);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, renderProcess.spritePipelineLayout, 0, uniformSet, m_uniformOffset);
+    vk::Pipeline boundPipeline = nullptr;
+    vk::DescriptorSet boundSet = nullptr;
+    for(uint32_t i=firstBatch; i<lastBatch; i++)
+    {
+        const Batch& batch = m_batches[i];
+        vk::Pipeline pipeline = instanced ? (batch.blend==BlendMode::eAdditive ? renderProcess.graphicsPipeline_spriteInstancedAdditive : renderProcess.graphicsPipeline_spriteInstanced)
+                                          : (batch.blend==BlendMode::eAdditive ? renderProcess.graphicsPipeline_spriteAdditive : renderProcess.graphicsPipeline_sprite);
+        if(pipeline!=boundPipeline)
+        {
+            cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);     /*布局相同，已绑定的描述符集保持有效*/
+            boundPipeline = pipeline;
+        }
+        if(batch.textureSet!=boundSet)
+        {
+            cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, renderProcess.spritePipelineLayout, 1, batch.textureSet, nullptr);
+            boundSet = batch.textureSet;
+        }
+        if(instanced)
+            cmdBuffer.drawIndexed(6, batch.spriteCount, 0, 0, batch.firstSprite);    /*firstInstance选择实例记录的起点*/
+        else
+            cmdBuffer.drawIndexed(batch.spriteCount*6, 1, 0, static_cast<int32_t>(batch.firstSprite*4), 0);
+    }
+}
+
+vk::DescriptorSet SpriteBatch::getTextureSet(const Texture& texture)
+{
+    auto it = m_textureSets.find(static_cast<VkImageView>(texture.view));
+    if(it!=m_textureSets.end())
+        return it->second.set;
+    auto& base_instance = VkBase::self();
+    TextureSet textureSet = allocateTextureSet();
+    vk::DescriptorSet set = textureSet.set;
+    vk::DescriptorImageInfo imageInfo(texture.sampler, texture.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::WriteDescriptorSet write = {};
+    write.setDstSet(set)
+         .setDstBinding(0)
+         .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+         .setImageInfo(imageInfo);
+    base_instance.device.updateDescriptorSets(write, nullptr);
+    m_textureSets[static_cast<VkImageView>(texture.view)] = textureSet;
+    return set;
+}
+
+vk::DescriptorPool SpriteBatch::createDescriptorPool()
+{
+    vk::DescriptorPoolSize poolSize;
+    poolSize.setType(vk::DescriptorType::eCombinedImageSampler)
+            .setDescriptorCount(256);
+    vk::DescriptorPoolCreateInfo createInfo = {};
+    createInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+              .setPoolSizes(poolSize)
+              .setMaxSets(256);
+    return VkBase::self().device.createDescriptorPool(createInfo);
+}
+
+SpriteBatch::TextureSet SpriteBatch::allocateTextureSet()
+{
+    /*纹理很多或碎片整理后旧集尚未释放时现有的池可能已满：依次尝试（从最新的池开始），都不够时创建新池*/
+    auto& base_instance = VkBase::self();
+    vk::DescriptorSetLayout layout = base_instance.spriteShader->getDescriptorSetLayouts()[1];
+    vk::DescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.setSetLayouts(layout);
+    vk::DescriptorSet set;
+    for(auto it=m_descriptorPools.rbegin(); it!=m_descriptorPools.rend(); it++)
+    {
+        allocateInfo.setDescriptorPool(*it);
+        vk::Result res = base_instance.device.allocateDescriptorSets(&allocateInfo, &set);
+        if(res==vk::Result::eSuccess)
+            return {set, *it};
+        if(res!=vk::Result::eErrorOutOfPoolMemory && res!=vk::Result::eErrorFragmentedPool)
+            throw std::runtime_error("[ SpriteBatch ]: Can't allocate texture descriptor set!");
+    }
+    m_descriptorPools.push_back(createDescriptorPool());
+    allocateInfo.setDescriptorPool(m_descriptorPools.back());
+    if(base_instance.device.allocateDescriptorSets(&allocateInfo, &set)!=vk::Result::eSuccess)
+        throw std::runtime_error("[ SpriteBatch ]: Can't allocate texture descriptor set!");
+    return {set, m_descriptorPools.back()};
+}
+
+void SpriteBatch::forget(vk::ImageView view)
+{
+    /*纹理视图销毁前调用：描述符集可能仍被in-flight帧使用，延迟释放*/
+    auto it = m_textureSets.find(static_cast<VkImageView>(view));
+    if(it==m_textureSets.end())
+        return;
+    vk::DescriptorSet set = it->second.set;
+    vk::DescriptorPool pool = it->second.pool;
+    m_textureSets.erase(it);
+    if(m_lastView==view)
+        m_lastView = nullptr;
+    if(VkBase::self().renderer)
+        VkBase::self().renderer->invalidate();      /*缓存的帧命令缓冲可能绑定了该描述符集*/
+    if(VkBase::self().deletionQueue)
+        VkBase::self().deletionQueue->push([pool, set](){ VkBase::self().device.freeDescriptorSets(pool, set); });
+    else
+        VkBase::self().device.freeDescriptorSets(pool, set);    /*程序退出时设备已空闲*/
+}
+
+
+
+}
@@ -0,0 +1,237 @@
+#include "sprite_scene.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+SpriteScene::SpriteScene(const std::vector<char>& cullSource, bool drawIndirectCount)
+    : m_commandCapacity(0), m_uploadedCount(0), m_drawIndirectCount(drawIndirectCount), m_texture(nullptr), m_textureSet(nullptr), m_blend(BlendMode::eAlpha),
+      m_viewRect(0.0f), m_version(0), m_lastBuffers{}, m_sets{}, m_boundBuffers{}
+{
+    auto& base_instance = VkBase::self();
+    auto& device = base_instance.device;
+    m_maxDrawCount = base_instance.physicalDevice.getProperties().limits.maxDrawIndirectCount;
+    /*1.对象数据与剔除输出：对象缓冲同时作为实例顶点输入，绘制数量缓冲每帧清零*/
+    m_objects = std::make_unique<GpuVector<SpriteInstance>>(vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eVertexBuffer);
+    m_count = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eIndirectBuffer|vk::BufferUsageFlagBits::eTransferDst,
+                                       sizeof(uint32_t), MemoryUsage::eGpuOnly);
+    /*2.描述符集布局：对象（只读）、绘制命令、绘制数量三个存储缓冲*/
+    std::array<vk::DescriptorSetLayoutBinding, 3> bindings = {};
+    for(uint32_t i=0; i<bindings.size(); i++)
+    {
+        bindings[i].setBinding(i)
+                   .setDescriptorCount(1)
+                   .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                   .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.setBindings(bindings);
+    m_setLayout = device.createDescriptorSetLayout(layoutInfo);
+    vk::PushConstantRange pushConstantRange = {};
+    pushConstantRange.setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                     .setOffset(0)
+                     .setSize(sizeof(CullConstants));
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.setSetLayouts(m_setLayout)
+                      .setPushConstantRanges(pushConstantRange);
+    m_pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+    /*3.每个in-flight帧一个描述符集（内容在首次使用或缓冲重建后写入）*/
+    vk::DescriptorPoolSize poolSize;
+    poolSize.setType(vk::DescriptorType::eStorageBuffer)
+            .setDescriptorCount(3*Renderer::maxFlightCount);
+    vk::DescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.setPoolSizes(poolSize)
+            .setMaxSets(Renderer::maxFlightCount);
+    m_descriptorPool = device.createDescriptorPool(poolInfo);
+    std::vector<vk::DescriptorSetLayout> setLayouts(Renderer::maxFlightCount, m_setLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.setDescriptorPool(m_descriptorPool)
+                .setSetLayouts(setLayouts);
+    auto sets = device.allocateDescriptorSets(allocateInfo);
+    std::copy(sets.begin(), sets.end(), m_sets.begin());
+    /*4.剔除管线*/
+    createPipeline(cullSource);
+}
+
+SpriteScene::~SpriteScene()
+{
+    auto& base_instance = VkBase::self();
+    base_instance.device.destroyPipeline(m_pipeline);
+    base_instance.device.destroyDescriptorPool(m_descriptorPool);
+    base_instance.device.destroyPipelineLayout(m_pipelineLayout);
+    base_instance.device.destroyDescriptorSetLayout(m_setLayout);
+    base_instance.resourceTracker->forget(m_count->buffer);
+    if(m_commands)
+        base_instance.resourceTracker->forget(m_commands->buffer);
+    m_count.reset();
+    m_commands.reset();
+    m_objects.reset();
+}
+
+void SpriteScene::createPipeline(const std::vector<char>& cullSource)
+{
+    if(cullSource.empty())
+        throw std::runtime_error("[ SpriteScene ]: Cull shader source is empty!");
+    auto& device = VkBase::self().device;
+    vk::ShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.setCodeSize(cullSource.size())
+              .setPCode(reinterpret_cast<const uint32_t*>(cullSource.data()));
+    vk::ShaderModule module = device.createShaderModule(moduleInfo);
+    vk::PipelineShaderStageCreateInfo stageInfo = {};
+    stageInfo.setStage(vk::ShaderStageFlagBits::eCompute)
+             .setModule(module)
+             .setPName("main");
+    vk::ComputePipelineCreateInfo createInfo = {};
+    createInfo.setStage(stageInfo)
+              .setLayout(m_pipelineLayout);
+    auto res = device.createComputePipeline(nullptr, createInfo);
+    device.destroyShaderModule(module);     /*管线创建后不再需要着色器模组*/
+    if(res.result!=vk::Result::eSuccess)
+        throw std::runtime_error("[ SpriteScene ]: Can't create culling compute pipeline!");
+    m_pipeline = res.value;
+}
+
+uint32_t SpriteScene::add(const Sprite& sprite)
+{
+    m_objects->push_back(makeInstance(sprite));
+    return static_cast<uint32_t>(m_objects->size()-1);
+}
+
+void SpriteScene::set(uint32_t id, const Sprite& sprite)
+{
+    m_objects->set(id, makeInstance(sprite));
+}
+
+void SpriteScene::clear()
+{
+    m_objects->clear();
+}
+
+void SpriteScene::setTexture(const Texture& texture, BlendMode blend)
+{
+    /*纹理需在场景清空或销毁之后再销毁*/
+    m_texture = &texture;
+    m_blend = blend;
+    m_version++;
+}
+
+void SpriteScene::upload()
+{
+    /*只有修改过的对象写入暂存环，本帧剔除和绘制的范围为已上传的对象*/
+    m_objects->upload();
+    uint32_t uploadedCount = static_cast<uint32_t>(std::min<size_t>(m_objects->size(), m_maxDrawCount));
+    reserveCommands(uploadedCount);
+    /*对象数据只在缓冲中，不影响录制的命令；数量或缓冲句柄（扩容、碎片整理移动）变化时需要重新录制*/
+    BoundBuffers current = {m_objects->getBuffer(), m_commands->buffer, m_count->buffer};
+    if(uploadedCount!=m_uploadedCount || current.objects!=m_lastBuffers.objects || current.commands!=m_lastBuffers.commands || current.count!=m_lastBuffers.count)
+        m_version++;
+    m_uploadedCount = uploadedCount;
+    m_lastBuffers = current;
+}
+
+void SpriteScene::reserveCommands(uint32_t count)
+{
+    if(count<=m_commandCapacity)
+        return;
+    /*按2倍扩容，旧缓冲可能仍被in-flight帧读取，延迟销毁*/
+    auto& base_instance = VkBase::self();
+    if(m_commands)
+    {
+        base_instance.resourceTracker->forget(m_commands->buffer);
+        base_instance.deletionQueue->retire(std::move(m_commands));
+    }
+    m_commandCapacity = std::max(count, m_commandCapacity*2);
+    m_commands = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eIndirectBuffer,
+                                          vk::DeviceSize(m_commandCapacity)*sizeof(vk::DrawIndexedIndirectCommand), MemoryUsage::eGpuOnly);
+}
+
+void SpriteScene::updateSet(uint32_t frameIndex)
+{
+    /*缓冲扩容或被碎片整理移动后句柄会变化；该帧槽位之前的提交已完成，可以直接更新*/
+    BoundBuffers current = {m_objects->getBuffer(), m_commands->buffer, m_count->buffer};
+    BoundBuffers& bound = m_boundBuffers[frameIndex];
+    if(bound.objects==current.objects && bound.commands==current.commands && bound.count==current.count)
+        return;
+    std::array<vk::DescriptorBufferInfo, 3> bufferInfos = {};
+    bufferInfos[0].setBuffer(current.objects).setOffset(0).setRange(VK_WHOLE_SIZE);
+    bufferInfos[1].setBuffer(current.commands).setOffset(0).setRange(VK_WHOLE_SIZE);
+    bufferInfos[2].setBuffer(current.count).setOffset(0).setRange(VK_WHOLE_SIZE);
+    std::array<vk::WriteDescriptorSet, 3> writes = {};
+    for(uint32_t i=0; i<writes.size(); i++)
+    {
+        writes[i].setDstSet(m_sets[frameIndex])
+                 .setDstBinding(i)
+                 .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                 .setBufferInfo(bufferInfos[i]);
+    }
+    VkBase::self().device.updateDescriptorSets(writes, nullptr);
+    bound = current;
+}
+
+void SpriteScene::cull(vk::CommandBuffer cmdBuffer, uint32_t frameIndex)
+{
+    /*在渲染流程之外调用*/
+    if(m_uploadedCount==0 || !m_texture)
+        return;
+    auto& base_instance = VkBase::self();
+    auto& tracker = *base_instance.resourceTracker;
+    updateSet(frameIndex);
+    m_textureSet = base_instance.spriteBatch->getTextureSet(*m_texture);
+
+    /*1.绘制数量清零（等待上一帧的间接绘制读取完成）。每帧都以间接绘制结束：
+        显式声明起始状态，录制结果与之前的录制历史无关，可被缓存的帧命令缓冲重放*/
+    tracker.assume(m_commands->buffer, ResourceUse::eIndirectBuffer);
+    tracker.assume(m_count->buffer, ResourceUse::eIndirectBuffer);
+    if(m_drawIndirectCount)
+    {
+        tracker.useBuffer(m_count->buffer, ResourceUse::eTransferDst);
+        tracker.flush(cmdBuffer);
+        cmdBuffer.fillBuffer(m_count->buffer, 0, sizeof(uint32_t), 0);
+        tracker.useBuffer(m_count->buffer, ResourceUse::eComputeReadWrite);
+    }
+    tracker.useBuffer(m_commands->buffer, ResourceUse::eComputeWrite);
+    tracker.flush(cmdBuffer);
+
+    /*2.每个对象一个线程，对可见区域剔除并写入绘制命令*/
+    vk::Extent2D extent = base_instance.swapchain->getExtent();
+    CullConstants constants = {};
+    constants.viewRect = m_viewRect.z>m_viewRect.x ? m_viewRect : glm::vec4(0.0f, 0.0f, float(extent.width), float(extent.height));
+    constants.objectCount = m_uploadedCount;
+    constants.compact = m_drawIndirectCount ? 1 : 0;
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_pipeline);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_pipelineLayout, 0, m_sets[frameIndex], nullptr);
+    cmdBuffer.pushConstants(m_pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+    cmdBuffer.dispatch((m_uploadedCount+63)/64, 1, 1);
+
+    /*3.命令与数量对间接绘制可见*/
+    tracker.useBuffer(m_commands->buffer, ResourceUse::eIndirectBuffer);
+    if(m_drawIndirectCount)
+        tracker.useBuffer(m_count->buffer, ResourceUse::eIndirectBuffer);
+    tracker.flush(cmdBuffer);
+}
+
+void SpriteScene::record(vk::CommandBuffer cmdBuffer, vk::DescriptorSet uniformSet)
+{
+    /*在渲染流程内调用（在cull之后），与精灵批处理共用实例化管线、单位四边形、索引和投影矩阵*/
+    if(m_uploadedCount==0 || !m_texture)
+        return;
+    auto& base_instance = VkBase::self();
+    auto& renderProcess = *base_instance.renderProcess;
+    auto& batch = *base_instance.spriteBatch;
+    vk::Pipeline pipeline = m_blend==BlendMode::eAdditive ? renderProcess.graphicsPipeline_spriteInstancedAdditive : renderProcess.graphicsPipeline_spriteInstanced;
+    cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    std::array<vk::Buffer,2> buffers = { batch.getQuadBuffer(), m_objects->getBuffer() };
+    std::array<vk::DeviceSize,2> offsets = { 0, 0 };
+    cmdBuffer.bindVertexBuffers(0, buffers, offsets);
+    cmdBuffer.bindIndexBuffer(batch.getIndexBuffer(), 0, vk::IndexType::eUint32);
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, renderProcess.spritePipelineLayout, 0, uniformSet, batch.getUniformOffset());
+    cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, renderProcess.spritePipelineLayout, 1, m_textureSet, nullptr);
+    if(m_drawIndirectCount)
+        cmdBuffer.drawIndexedIndirectCount(m_commands->buffer, 0, m_count->buffer, 0, m_uploadedCount, sizeof(vk::DrawIndexedIndirectCommand));
+    else
+        cmdBuffer.drawIndexedIndirect(m_commands->buffer, 0, m_uploadedCount, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+
+
+}
@@ -0,0 +1,263 @@
+#include "staging_belt.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+StagingBelt::StagingBelt(vk::DeviceSize capacity) : m_capacity(capacity), m_head(0), m_tail(0), m_pendingBegin(0)
+{
+    m_buffer = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eTransferSrc, m_capacity, MemoryUsage::eUpload);
+}
+
+StagingBelt::~StagingBelt()
+{
+    m_buffer.reset();
+}
+
+void StagingBelt::uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size)
+{
+    const char* src = static_cast<const char*>(data);
+    vk::DeviceSize done = 0;
+    while(done < size)
+    {
+        /*暂存环已满时先提交已有拷贝，超过容量的数据分块上传*/
+        vk::DeviceSize chunk = std::min(size-done, available(4));
+        if(chunk==0)
+        {
+            makeRoom();
+            continue;
+        }
+        vk::DeviceSize offset = reserve(chunk, 4);
+        memcpy(static_cast<char*>(m_buffer->data)+offset, src+done, chunk);
+
+        BufferCopy copy = {};
+        copy.dst = dst;
+        copy.region.setSrcOffset(offset)            /*暂存环中的起始位置*/
+                   .setDstOffset(dstOffset+done)    /*目的缓冲中的起始位置*/
+                   .setSize(chunk);
+        m_bufferCopies.push_back(copy);
+        done += chunk;
+    }
+}
+
+void StagingBelt::uploadImage(vk::Image dst, uint32_t width, uint32_t height, const void* data, vk::DeviceSize size)
+{
+    uploadImageRows(dst, width, height, 0, height, data, size/height);  /*紧凑排列的每行字节数*/
+}
+
+void StagingBelt::uploadImageRows(vk::Image dst, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t rowCount, const void* data, vk::DeviceSize rowPitch)
+{
+    /*图像可分多次（跨帧）按行上传：第一行之前转换为传输布局，最后一行之后转换为shader只读布局*/
+    const char* src = static_cast<const char*>(data) - firstRow*rowPitch;
+    uint32_t endRow = firstRow + rowCount;
+    if(firstRow==0)
+        m_preTransitions.push_back(dst);
+    uint32_t row = firstRow;
+    while(row < endRow)
+    {
+        /*按行分块：暂存环放不下整张图像时分多次提交*/
+        uint32_t rows = static_cast<uint32_t>(std::min<vk::DeviceSize>(endRow-row, available(16)/rowPitch));
+        if(rows==0)
+        {
+            if(unused())
+                throw std::runtime_error("[ StagingBelt ]: Image row is larger than the staging belt!");
+            makeRoom();
+            continue;
+        }
+        vk::DeviceSize offset = reserve(rows*rowPitch, 16);
+        memcpy(static_cast<char*>(m_buffer->data)+offset, src+row*rowPitch, rows*rowPitch);
+
+        vk::ImageSubresourceLayers subresourceLayers;
+        subresourceLayers.setAspectMask(vk::ImageAspectFlagBits::eColor)
+                         .setMipLevel(0)
+                         .setBaseArrayLayer(0).setLayerCount(1);
+        ImageCopy copy = {};
+        copy.dst = dst;
+        copy.region.setBufferOffset(offset)                                                 /*暂存环中的起始位置*/
+                   .setBufferRowLength(0)                                                   /*紧凑对齐*/
+                   .setBufferImageHeight(0)
+                   .setImageSubresource(subresourceLayers)
+                   .setImageOffset(vk::Offset3D{0, static_cast<int32_t>(row), 0})          /*该分块在图像中的起始行*/
+                   .setImageExtent(vk::Extent3D{width, rows, 1});
+        m_imageCopies.push_back(copy);
+        row += rows;
+    }
+    if(endRow==height)
+        m_postTransitions.push_back(dst);
+}
+
+void StagingBelt::flush()
+{
+    if(empty())
+        return;
+
+    /*暂存环为非一致内存时，拷贝前flush本次提交写入的区间（回绕时分为两段）*/
+    if(m_head>=m_pendingBegin)
+        m_buffer->flush(m_pendingBegin, m_head-m_pendingBegin);
+    else
+    {
+        m_buffer->flush(m_pendingBegin, m_capacity-m_pendingBegin);
+        m_buffer->flush(0, m_head);
+    }
+    VkBase::self().allocator->flushMappedRanges();
+
+    auto& base_instance = VkBase::self();
+    vk::Buffer staging = m_buffer->buffer;
+    uint32_t graphicsFamily = base_instance.queueFamilyIndex.graphicsIndex.value();
+    auto& tracker = *base_instance.resourceTracker;
+    auto recordImageUploads = [&](vk::CommandBuffer cmdBuffer, bool tracked)
+    {
+        /*图形队列上由资源状态跟踪生成屏障，所有图像的布局变换合并为一次pipelineBarrier2*/
+        for(auto& image : m_preTransitions)
+        {
+            if(tracked)
+                tracker.useImage(image, ResourceUse::eTransferDst, 0, 1, true);
+            else
+                Commander::recordTransition(cmdBuffer, image, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
+        }
+        tracker.flush(cmdBuffer);
+        for(auto& copy : m_imageCopies)
+            cmdBuffer.copyBufferToImage(staging, copy.dst, vk::ImageLayout::eTransferDstOptimal, copy.region);
+    };
+
+    /*1.图像上传：有专用传输队列时单独提交，拷贝完成后把所有权释放给图形队列*/
+    InflightRegion region = {};
+    bool dedicatedTransfer = base_instance.transferCommander && !m_imageCopies.empty();
+    if(dedicatedTransfer)
+    {
+        Commander& transfer = *base_instance.transferCommander;
+        transfer.beginBatch();
+        transfer.recordCommands([&](vk::CommandBuffer cmdBuffer){ recordImageUploads(cmdBuffer, false); });
+        for(auto& image : m_postTransitions)
+            transfer.recordRelease(image, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, graphicsFamily);
+        region.transferToken = transfer.submitBatch();
+    }
+
+    /*2.其余的布局变换和拷贝记录进图形队列的同一命令缓冲，一次提交*/
+    if(!m_bufferCopies.empty() || !dedicatedTransfer)
+    {
+        region.token = base_instance.commander->submitAsync([&](vk::CommandBuffer cmdBuffer)
+        {
+            /*等待之前提交的帧读完目标缓冲后再覆盖（写后读冲突只需执行依赖）*/
+            cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(0),
+                                      nullptr, nullptr, nullptr);
+            if(!dedicatedTransfer)
+                recordImageUploads(cmdBuffer, true);
+            /*目标相同的相邻拷贝合并为一次copyBuffer*/
+            std::vector<vk::BufferCopy> regions;
+            for(size_t i=0; i<m_bufferCopies.size(); i++)
+            {
+                regions.push_back(m_bufferCopies[i].region);
+                if(i+1==m_bufferCopies.size() || m_bufferCopies[i+1].dst!=m_bufferCopies[i].dst)
+                {
+                    cmdBuffer.copyBuffer(staging, m_bufferCopies[i].dst, regions);
+                    regions.clear();
+                }
+            }
+            if(!dedicatedTransfer)
+            {
+                /*第0层写入完成：需要mip链的图像在同一命令缓冲中生成其余层级*/
+                for(auto& image : m_postTransitions)
+                {
+                    if(base_instance.mipmapGenerator->isPending(image))
+                        base_instance.mipmapGenerator->record(cmdBuffer, image);
+                    else
+                        tracker.useImage(image, ResourceUse::eFragmentSampled, 0, 1);
+                }
+                tracker.flush(cmdBuffer);
+            }
+            /*拷贝写入对之后提交的顶点/索引/uniform读取以及碎片整理的移动拷贝可见*/
+            vk::MemoryBarrier barrier = {};
+            barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                   .setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead|vk::AccessFlagBits::eIndexRead|vk::AccessFlagBits::eUniformRead|vk::AccessFlagBits::eShaderRead
+                                     |vk::AccessFlagBits::eTransferRead);
+            cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags(0),
+                                      barrier, nullptr, nullptr);
+        });
+    }
+
+    /*提交不阻塞：本次使用的暂存区间在两个队列上的提交都完成后才回收*/
+    region.end = m_head;
+    m_inflight.push_back(region);
+    m_pendingBegin = m_head;
+    m_bufferCopies.clear();
+    m_imageCopies.clear();
+    m_preTransitions.clear();
+    m_postTransitions.clear();
+}
+
+void StagingBelt::wait()
+{
+    /*等待所有已提交的拷贝在两个队列上完成（碎片整理移动资源前调用）*/
+    for(auto& region : m_inflight)
+    {
+        VkBase::self().commander->wait(region.token);
+        if(VkBase::self().transferCommander)
+            VkBase::self().transferCommander->wait(region.transferToken);
+    }
+    reclaim();
+}
+
+bool StagingBelt::isComplete(const InflightRegion& region)
+{
+    auto& base_instance = VkBase::self();
+    if(!base_instance.commander->isComplete(region.token))
+        return false;
+    return !base_instance.transferCommander || base_instance.transferCommander->isComplete(region.transferToken);
+}
+
+void StagingBelt::reclaim()
+{
+    /*回收GPU已完成的提交占用的暂存区间（按提交顺序回收）*/
+    while(!m_inflight.empty() && isComplete(m_inflight.front()))
+    {
+        m_tail = m_inflight.front().end;
+        m_inflight.pop_front();
+    }
+    /*暂存环完全空闲时回到起点，减少回绕*/
+    if(unused())
+        m_head = m_tail = m_pendingBegin = 0;
+}
+
+void StagingBelt::makeRoom()
+{
+    /*暂存环已满：先提交已记录的拷贝，再等待最早的一次提交完成*/
+    if(!empty())
+        flush();
+    if(!m_inflight.empty())
+    {
+        VkBase::self().commander->wait(m_inflight.front().token);
+        if(VkBase::self().transferCommander)
+            VkBase::self().transferCommander->wait(m_inflight.front().transferToken);
+    }
+    reclaim();
+}
+
+vk::DeviceSize StagingBelt::available(vk::DeviceSize alignment)
+{
+    reclaim();
+    vk::DeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+    if(m_head>=m_tail)
+    {
+        /*未回绕：可用[head,capacity)，或回绕到起点使用[0,tail)*/
+        vk::DeviceSize end = offset<m_capacity ? m_capacity-offset : 0;
+        vk::DeviceSize wrapped = m_tail>0 ? m_tail-1 : 0;
+        return std::max(end, wrapped);
+    }
+    /*已回绕：可用[head,tail)，保留1字节以区分满和空*/
+    return offset+1<m_tail ? m_tail-offset-1 : 0;
+}
+
+vk::DeviceSize StagingBelt::reserve(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    /*调用前已由available保证空间足够*/
+    vk::DeviceSize offset = (m_head + alignment - 1) / alignment * alignment;
+    if(m_head>=m_tail && offset+size>m_capacity)
+        offset = 0;     /*尾部空间不足，回绕到起点*/
+    m_head = offset + size;
+    return offset;
+}
+
+
+
+}
@@ -3,7 +3,7 @@
 
 namespace vulkan2d{
 
-Swapchain::Swapchain(vk::SurfaceKHR surface_) : surface(surface_), m_oldSwapchain(nullptr)
+Swapchain::Swapchain(vk::SurfaceKHR surface_, vk::SwapchainKHR oldSwapchain) : surface(surface_), m_oldSwapchain(oldSwapchain)
 {
     /*1.获取物理设备支持的surface属性*/
     if(!getSwapchainSupportInfo(surface))
@@ -21,12 +21,14 @@ Swapchain::Swapchain(vk::SurfaceKHR surface_) : surface(surface_), m_oldSwapchai
 
 Swapchain::~Swapchain()
 {
+    for(size_t i=0; i<images.size(); i++)
+        VkBase::self().allocator->untrack(MemoryCategory::eRenderTarget, m_imageBytes);
     for(auto& fb: framebuffers)
         VkBase::self().device.destroyFramebuffer(fb);
     for(auto& img : images)
         VkBase::self().device.destroyImageView(img.view);
     VkBase::self().device.destroySwapchainKHR(swapchain);
-    VkBase::self().instance.destroySurfaceKHR(surface);
+    /*surface由VkBase持有，重建交换链时沿用*/
 }
 
 void Swapchain::initFramebuffers()
@@ -93,6 +95,9 @@ vk::Extent2D Swapchain::querySurfaceExtent(uint32_t default_width, uint32_t defa
 
 vk::SwapchainKHR Swapchain::createSwapchain()
 {
+    m_imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+    if(m_swapchainSupportInfo.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc)
+        m_imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
     vk::SwapchainCreateInfoKHR createInfo = {};
     createInfo.setPNext(nullptr)
               .setClipped(true)
@@ -100,7 +105,7 @@ vk::SwapchainKHR Swapchain::createSwapchain()
               .setImageColorSpace(m_surfaceProperty.format.colorSpace)
               .setImageFormat(m_surfaceProperty.format.format)
               .setImageExtent(m_surfaceProperty.extent)
-              .setImageUsage(vk::ImageUsageFlagBits::eColorAttachment)
+              .setImageUsage(m_imageUsage)
               .setImageArrayLayers(1)   /*2D-monitor*/
               .setMinImageCount(m_surfaceProperty.minImageCount)
               .setSurface(surface)
@@ -124,6 +129,8 @@ vk::SwapchainKHR Swapchain::createSwapchain()
 void Swapchain::createImageAndViews()
 {
     std::vector<vk::Image> swapchainImages = VkBase::self().device.getSwapchainImagesKHR(swapchain);
+    /*交换链图像由显示引擎分配，无法查询内存需求，按4字节/像素估算*/
+    m_imageBytes = vk::DeviceSize(m_surfaceProperty.extent.width) * m_surfaceProperty.extent.height * 4;
     for(auto img : swapchainImages)
     {
         Image image = {};
@@ -145,6 +152,7 @@ void Swapchain::createImageAndViews()
                   .setImage(image.image);                       /*设置原始图像*/
         image.view = VkBase::self().device.createImageView(createInfo);
         this->images.push_back(image);
+        VkBase::self().allocator->track(MemoryCategory::eRenderTarget, m_imageBytes);
     }
 }
 
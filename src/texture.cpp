@@ -0,0 +1,156 @@
+#include "texture.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+Texture::Texture(uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, uint32_t mipLevels)
+    : extent{width, height, 1}, format(format), mipLevels(mipLevels), m_relocatedImage(nullptr)
+{
+    auto& allocator = *VkBase::self().allocator;
+    m_usage = usage | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;   /*允许碎片整理时拷贝移动（也是blit生成mipmap所需）*/
+    if(mipLevels>1 && !VkBase::self().mipmapGenerator->supportsBlit(format))
+        m_usage |= vk::ImageUsageFlagBits::eStorage;    /*计算着色器回退路径逐层写入*/
+    /*1.创建纹理图像对象*/
+    image = createImage();
+    if(!image)
+        throw std::runtime_error("[ Texture ]: Can't create image!");
+    /*2.按GPU专用策略从VMA内存块中分配并绑定图像内存*/
+    VmaAllocationInfo allocInfo = {};
+    uint32_t typeBits = VkBase::self().device.getImageMemoryRequirements(image).memoryTypeBits;
+    try
+    {
+        allocation = allocator.allocateImage(image, allocator.rankMemoryTypes(typeBits, MemoryUsage::eGpuOnly), allocInfo);
+    }
+    catch(const std::exception&)
+    {
+        VkBase::self().device.destroyImage(image);
+        throw;
+    }
+    memorySize = allocInfo.size;
+    allocator.track(MemoryCategory::eTexture, memorySize);
+    vmaSetAllocationUserData(allocator.getHandle(), allocation, static_cast<Relocatable*>(this));
+    /*3.登记到资源状态跟踪（初始为未定义布局）*/
+    VkBase::self().resourceTracker->registerImage(image, mipLevels);
+    /*4.创建覆盖全部mip层级的视图和采样器*/
+    view = createView(image);
+    sampler = createSampler();
+}
+
+Texture::~Texture()
+{
+    auto& base_instance = VkBase::self();
+    base_instance.allocator->untrack(MemoryCategory::eTexture, memorySize);
+    if(base_instance.resourceTracker)
+        base_instance.resourceTracker->forget(image);
+    if(base_instance.mipmapGenerator)
+        base_instance.mipmapGenerator->cancel(image);
+    if(base_instance.uploadScheduler)
+        base_instance.uploadScheduler->cancel(image);
+    if(base_instance.spriteBatch)
+        base_instance.spriteBatch->forget(view);
+    base_instance.device.destroySampler(sampler);
+    base_instance.device.destroyImageView(view);
+    /*正在被碎片整理移动的分配由VMA在pass结束时释放，这里只销毁图像对象*/
+    if(base_instance.defragmenter && base_instance.defragmenter->release(allocation))
+        base_instance.device.destroyImage(image);
+    else
+        vmaDestroyImage(base_instance.allocator->getHandle(), static_cast<VkImage>(image), allocation);
+}
+
+vk::Image Texture::createImage()
+{
+    vk::ImageCreateInfo createInfo = {};
+    createInfo.setImageType(vk::ImageType::e2D)                 /*设置图像对象类型为2D*/
+              .setExtent(extent)                                /*设置图像大小（2D深度为1）*/
+              .setMipLevels(mipLevels)                          /*设置mipmap层数*/
+              .setArrayLayers(1)                                /*纹理数组仅自身*/
+              .setFormat(format)                                /*设置图像格式*/
+              .setTiling(vk::ImageTiling::eOptimal)             /*设置像素如何排列*/
+              .setInitialLayout(vk::ImageLayout::eUndefined)    /*设置初始化布局*/
+              .setUsage(m_usage)                                /*设置图像对象用途*/
+              .setSharingMode(vk::SharingMode::eExclusive)      /*设置共享模式为队列独有*/
+              .setSamples(vk::SampleCountFlagBits::e1);         /*设置采样数为1*/
+    return VkBase::self().device.createImage(createInfo);
+}
+
+vk::ImageView Texture::createView(vk::Image image)
+{
+    vk::ImageSubresourceRange range;
+    range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+         .setBaseMipLevel(0).setLevelCount(mipLevels)       /*覆盖全部mip层级*/
+         .setBaseArrayLayer(0).setLayerCount(1);
+    vk::ImageViewCreateInfo createInfo = {};
+    createInfo.setImage(image)
+              .setViewType(vk::ImageViewType::e2D)
+              .setFormat(format)
+              .setSubresourceRange(range);
+    return VkBase::self().device.createImageView(createInfo);
+}
+
+vk::Sampler Texture::createSampler()
+{
+    vk::SamplerCreateInfo createInfo = {};
+    createInfo.setMagFilter(vk::Filter::eLinear)
+              .setMinFilter(vk::Filter::eLinear)
+              .setMipmapMode(vk::SamplerMipmapMode::eLinear)       /*缩小时在相邻mip层间插值，避免闪烁*/
+              .setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+              .setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+              .setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+              .setMinLod(0.0f)
+              .setMaxLod(static_cast<float>(mipLevels));
+    return VkBase::self().device.createSampler(createInfo);
+}
+
+void Texture::recordRelocation(vk::CommandBuffer cmdBuffer, VmaAllocation dstAllocation)
+{
+    /*1.以相同参数重建图像并绑定到目标内存*/
+    m_relocatedImage = createImage();
+    if(vmaBindImageMemory(VkBase::self().allocator->getHandle(), dstAllocation, static_cast<VkImage>(m_relocatedImage))!=VK_SUCCESS)
+        throw std::runtime_error("[ Texture ]: Can't bind relocated image memory!");
+    /*2.布局变换后逐层拷贝，完成后新图像转换回shader只读布局（两张图像的屏障合并为一次提交）*/
+    auto& tracker = *VkBase::self().resourceTracker;
+    tracker.registerImage(m_relocatedImage, mipLevels);
+    tracker.useImage(image, ResourceUse::eTransferSrc);
+    tracker.useImage(m_relocatedImage, ResourceUse::eTransferDst, 0, VK_REMAINING_MIP_LEVELS, true);
+    tracker.flush(cmdBuffer);
+    std::vector<vk::ImageCopy> regions(mipLevels);
+    for(uint32_t level=0; level<mipLevels; level++)
+    {
+        vk::ImageSubresourceLayers subresourceLayers;
+        subresourceLayers.setAspectMask(vk::ImageAspectFlagBits::eColor)
+                         .setMipLevel(level)
+                         .setBaseArrayLayer(0).setLayerCount(1);
+        regions[level].setSrcSubresource(subresourceLayers)
+                      .setDstSubresource(subresourceLayers)
+                      .setSrcOffset(vk::Offset3D{0, 0, 0})
+                      .setDstOffset(vk::Offset3D{0, 0, 0})
+                      .setExtent(vk::Extent3D{std::max(extent.width>>level, 1u), std::max(extent.height>>level, 1u), 1});
+    }
+    cmdBuffer.copyImage(image, vk::ImageLayout::eTransferSrcOptimal, m_relocatedImage, vk::ImageLayout::eTransferDstOptimal, regions);
+    tracker.useImage(m_relocatedImage, ResourceUse::eFragmentSampled);
+    tracker.flush(cmdBuffer);
+}
+
+std::function<void()> Texture::commitRelocation()
+{
+    /*后续录制的命令使用新图像和新视图，旧视图和旧图像交由延迟销毁队列在其引用帧完成后销毁*/
+    vk::Image oldImage = image;
+    vk::ImageView oldView = view;
+    image = m_relocatedImage;
+    view = createView(image);
+    m_relocatedImage = nullptr;
+    VkBase::self().resourceTracker->forget(oldImage);
+    VkBase::self().uploadScheduler->retarget(oldImage, image);
+    return [oldImage, oldView]()
+    {
+        if(VkBase::self().spriteBatch)
+            VkBase::self().spriteBatch->forget(oldView);
+        VkBase::self().device.destroyImageView(oldView);
+        VkBase::self().device.destroyImage(oldImage);
+    };
+}
+
+
+
+}
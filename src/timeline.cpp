@@ -0,0 +1,51 @@
+#include "timeline.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+Timeline::Timeline() : m_lastValue(0), m_completedValue(0)
+{
+    vk::SemaphoreTypeCreateInfo typeCreateInfo = {};
+    typeCreateInfo.setSemaphoreType(vk::SemaphoreType::eTimeline)   /*时间线信号量*/
+                  .setInitialValue(0);                              /*初始计数值*/
+    vk::SemaphoreCreateInfo createInfo = {};
+    createInfo.setPNext(&typeCreateInfo);
+    m_semaphore = VkBase::self().device.createSemaphore(createInfo);
+    objectCounters().semaphores++;
+}
+
+Timeline::~Timeline()
+{
+    VkBase::self().device.destroySemaphore(m_semaphore);
+}
+
+uint64_t Timeline::getCompletedValue()
+{
+    m_completedValue = std::max(m_completedValue, VkBase::self().device.getSemaphoreCounterValue(m_semaphore));
+    return m_completedValue;
+}
+
+bool Timeline::isComplete(uint64_t value)
+{
+    if(value<=m_completedValue)
+        return true;
+    return value<=getCompletedValue();
+}
+
+bool Timeline::wait(uint64_t value, uint64_t timeout)
+{
+    if(isComplete(value))
+        return true;
+    vk::SemaphoreWaitInfo waitInfo = {};
+    waitInfo.setSemaphores(m_semaphore)     /*等待的时间线*/
+            .setValues(value);              /*等待计数值达到该值*/
+    if(VkBase::self().device.waitSemaphores(waitInfo, timeout)!=vk::Result::eSuccess)
+        return false;
+    m_completedValue = std::max(m_completedValue, value);
+    return true;
+}
+
+
+
+}
@@ -0,0 +1,195 @@
+#include "upload_scheduler.hpp"
+#include "vkBase.hpp"
+
+
+namespace vulkan2d{
+
+UploadScheduler::UploadScheduler(vk::DeviceSize bytesPerFrame, double millisecondsPerFrame)
+    : m_bytesPerFrame(bytesPerFrame), m_millisecondsPerFrame(millisecondsPerFrame), m_pendingBytes(0), m_uploadedBytes(0), m_nextTicket(1)
+{
+}
+
+UploadScheduler::~UploadScheduler()
+{
+}
+
+void UploadScheduler::setBudget(vk::DeviceSize bytesPerFrame, double millisecondsPerFrame)
+{
+    m_bytesPerFrame = bytesPerFrame;
+    m_millisecondsPerFrame = millisecondsPerFrame;
+}
+
+UploadScheduler::Ticket UploadScheduler::scheduleBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size,
+                                                        UploadPriority priority, std::function<void()> onComplete)
+{
+    Request request = {};
+    request.buffer = dst;
+    request.dstOffset = dstOffset;
+    request.data.assign(static_cast<const char*>(data), static_cast<const char*>(data)+size);
+    request.onComplete = std::move(onComplete);
+    return enqueue(std::move(request), priority);
+}
+
+UploadScheduler::Ticket UploadScheduler::scheduleImage(vk::Image dst, uint32_t width, uint32_t height, const void* data, vk::DeviceSize size,
+                                                       UploadPriority priority, std::function<void()> onComplete)
+{
+    if(width==0 || height==0)
+        throw std::runtime_error("[ UploadScheduler ]: Can't schedule an image with zero extent!");
+    Request request = {};
+    request.image = dst;
+    request.width = width;
+    request.height = height;
+    request.rowPitch = size / height;   /*紧凑排列的每行字节数*/
+    request.data.assign(static_cast<const char*>(data), static_cast<const char*>(data)+size);
+    request.onComplete = std::move(onComplete);
+    return enqueue(std::move(request), priority);
+}
+
+UploadScheduler::Ticket UploadScheduler::enqueue(Request&& request, UploadPriority priority)
+{
+    request.ticket = m_nextTicket++;
+    request.uploaded = 0;
+    m_pendingBytes += request.data.size();
+    Ticket ticket = request.ticket;
+    m_queues[priority].push_back(std::move(request));
+    return ticket;
+}
+
+bool UploadScheduler::cancel(Ticket ticket)
+{
+    /*目的资源被提前销毁时取消其上传（已部分上传的图像内容未定义）*/
+    return cancelIf([ticket](const Request& request){ return request.ticket==ticket; });
+}
+
+bool UploadScheduler::cancel(vk::Buffer dst)
+{
+    /*缓冲/图像析构时调用：取消所有写入该资源的请求，避免之后的暂存环拷贝写入已销毁的句柄*/
+    return cancelIf([dst](const Request& request){ return request.buffer==dst; });
+}
+
+bool UploadScheduler::cancel(vk::Image dst)
+{
+    return cancelIf([dst](const Request& request){ return request.image==dst; });
+}
+
+void UploadScheduler::retarget(vk::Buffer oldDst, vk::Buffer newDst)
+{
+    /*碎片整理移动缓冲后，剩余数据写入新缓冲（已上传的部分随移动拷贝过去）*/
+    for(auto& [priority, queue] : m_queues)
+    {
+        for(auto& request : queue)
+        {
+            if(request.buffer==oldDst)
+                request.buffer = newDst;
+        }
+    }
+}
+
+void UploadScheduler::retarget(vk::Image oldDst, vk::Image newDst)
+{
+    /*新图像需要从第0行重新上传：首行之前的布局变换只对新图像记录一次*/
+    for(auto& [priority, queue] : m_queues)
+    {
+        for(auto& request : queue)
+        {
+            if(request.image!=oldDst)
+                continue;
+            request.image = newDst;
+            m_pendingBytes += request.uploaded;
+            request.uploaded = 0;
+        }
+    }
+}
+
+bool UploadScheduler::cancelIf(const std::function<bool(const Request&)>& match)
+{
+    bool cancelled = false;
+    for(auto& [priority, queue] : m_queues)
+    {
+        for(auto it=queue.begin(); it!=queue.end();)
+        {
+            if(!match(*it))
+            {
+                it++;
+                continue;
+            }
+            m_pendingBytes -= it->data.size() - it->uploaded;
+            it = queue.erase(it);
+            cancelled = true;
+        }
+    }
+    return cancelled;
+}
+
+bool UploadScheduler::isPending(Ticket ticket) const
+{
+    for(auto& [priority, queue] : m_queues)
+    {
+        for(auto& request : queue)
+        {
+            if(request.ticket==ticket)
+                return true;
+        }
+    }
+    return false;
+}
+
+void UploadScheduler::update()
+{
+    /*每帧在暂存环提交前调用：按优先级依次上传，直到用完字节预算或时间预算*/
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    m_uploadedBytes = 0;
+    for(auto& [priority, queue] : m_queues)
+    {
+        while(!queue.empty())
+        {
+            bool immediate = (priority==UploadPriority::eImmediate);
+            double elapsed = std::chrono::duration<double, std::milli>(clock::now()-start).count();
+            /*每帧至少推进一块，保证预算很小时上传也能完成*/
+            if(!immediate && m_uploadedBytes>0 && (m_uploadedBytes>=m_bytesPerFrame || elapsed>=m_millisecondsPerFrame))
+                return;
+            vk::DeviceSize budget = immediate ? std::numeric_limits<vk::DeviceSize>::max()
+                                              : (m_uploadedBytes<m_bytesPerFrame ? m_bytesPerFrame-m_uploadedBytes : 0);
+            Request& request = queue.front();
+            vk::DeviceSize bytes = uploadChunk(request, budget);
+            m_uploadedBytes += bytes;
+            m_pendingBytes -= bytes;
+            if(request.uploaded<request.data.size())
+                continue;
+            /*最后一块已写入暂存环，随本帧的暂存环提交，之后录制的命令可以使用该资源*/
+            std::function<void()> onComplete = std::move(request.onComplete);
+            queue.pop_front();
+            if(onComplete)
+                onComplete();
+        }
+    }
+}
+
+vk::DeviceSize UploadScheduler::uploadChunk(Request& request, vk::DeviceSize budget)
+{
+    auto& stagingBelt = *VkBase::self().stagingBelt;
+    vk::DeviceSize remaining = request.data.size() - request.uploaded;
+    if(request.buffer)
+    {
+        /*缓冲按4字节对齐分块*/
+        vk::DeviceSize bytes = remaining;
+        if(bytes>budget)
+            bytes = std::max<vk::DeviceSize>(budget/4*4, 4);
+        bytes = std::min(bytes, remaining);
+        stagingBelt.uploadBuffer(request.buffer, request.dstOffset+request.uploaded, request.data.data()+request.uploaded, bytes);
+        request.uploaded += bytes;
+        return bytes;
+    }
+    /*图像按整行分块，预算不足一行时也至少上传一行*/
+    uint32_t firstRow = static_cast<uint32_t>(request.uploaded / request.rowPitch);
+    uint32_t rows = static_cast<uint32_t>(std::min<vk::DeviceSize>(request.height-firstRow, std::max<vk::DeviceSize>(budget/request.rowPitch, 1)));
+    stagingBelt.uploadImageRows(request.image, request.width, request.height, firstRow, rows,
+                                request.data.data()+request.uploaded, request.rowPitch);
+    request.uploaded += rows*request.rowPitch;
+    return rows*request.rowPitch;
+}
+
+
+
+}
@@ -44,12 +44,10 @@ VkBase::VkBase(const std::vector<const char*>& extensions_, std::function<vk::Su
     if(!device)
         throw std::runtime_error("[ LogicalDevice ]: Can't create  logical device!");
     /*5.获取设备队列*/
-    if(queueFamilyIndex.graphicsIndex.has_value())
-        graphicsQueue = device.getQueue(queueFamilyIndex.graphicsIndex.value(), 0);
-    if(queueFamilyIndex.presentIndex.has_value())
-        presentQueue = device.getQueue(queueFamilyIndex.presentIndex.value(), 0);
-    if(queueFamilyIndex.computeIndex.has_value())
-        computeQueue = device.getQueue(queueFamilyIndex.computeIndex.value(), 0);
+    graphicsQueue = device.getQueue(queueFamilyIndex.graphicsIndex.value(), 0);
+    presentQueue = device.getQueue(queueFamilyIndex.presentIndex.value(), 0);
+    computeQueue = device.getQueue(queueFamilyIndex.computeIndex.value(), 0);
+    transferQueue = device.getQueue(queueFamilyIndex.transferIndex.value(), 0);
 }
 
 void VkBase::destroy()
@@ -59,17 +57,43 @@ void VkBase::destroy()
 
 VkBase::~VkBase()
 {
-    for(int i=0; i<renderer->getFlightCount(); i++)
-        uniformBuffers[i].reset();
+    deletionQueue.reset();  /*设备已空闲，执行所有延迟销毁*/
+    defragmenter.reset();   /*结束进行中的碎片整理pass*/
+    uniformRing.reset();
+    uploadScheduler.reset();
+    readback.reset();
+    spriteBenchmark.reset();
+    spriteScene.reset();
+    spriteBatch.reset();
+    stagingBelt.reset();
     renderer.reset();
     indexBuffer.reset();
     vertexBuffer.reset();
+    texture.reset();
+    mipmapGenerator.reset();
+    transferCommander.reset();
+    commander.reset();
+    transferTimeline.reset();
+    graphicsTimeline.reset();
+    resourceTracker.reset();
+    parallelRecorder.reset();   /*结束录制线程，释放各线程的命令池*/
     commandManager.reset();
+    syncPool.reset();
     device.destroyPipeline(renderProcess->graphicsPipeline_triangle);
+    device.destroyPipeline(renderProcess->graphicsPipeline_pull);
+    device.destroyPipeline(renderProcess->graphicsPipeline_sprite);
+    device.destroyPipeline(renderProcess->graphicsPipeline_spriteAdditive);
+    device.destroyPipeline(renderProcess->graphicsPipeline_spriteInstanced);
+    device.destroyPipeline(renderProcess->graphicsPipeline_spriteInstancedAdditive);
     renderProcess.reset();
+    spriteInstancedShader.reset();
+    spriteShader.reset();
+    pullShader.reset();
     shader.reset();
     swapchain.reset();
+    instance.destroySurfaceKHR(m_surface);
     descriptorManager.reset();
+    allocator.reset();
     device.destroy();
 #ifndef NDEBUG
     instance.destroyDebugUtilsMessengerEXT(m_debugMessenger, nullptr, loadInstanceDynamicLoader());
@@ -155,30 +179,66 @@ vk::PhysicalDevice VkBase::pickPhysicalDevice()
     return nullptr;
 }
 
-struct QueueFamilyIndex VkBase::queryQueueFamilyIndex(bool enableGraphicsQueue, bool enablePresentQueue, bool enableComputQueue)
+struct QueueFamilyIndex VkBase::queryQueueFamilyIndex()
 {
+    /*队列拓扑规划：按能力为每种用途挑选最合适的队列族，而不是简单取最后一个满足条件的队列族*/
     struct QueueFamilyIndex res;
     std::vector<vk::QueueFamilyProperties> qfProperties = physicalDevice.getQueueFamilyProperties();
-    for(int i=0; i<qfProperties.size(); i++)
+    auto hasFlags = [&](uint32_t i, vk::QueueFlags flags) -> bool { return (qfProperties[i].queueFlags&flags)==flags; };
+    /*  分块上传图像时拷贝区域按行划分，要求传输粒度为1x1x1*/
+    auto isFineGrained = [&](uint32_t i) -> bool
     {
-        if(enableGraphicsQueue && (qfProperties[i].queueFlags&vk::QueueFlagBits::eGraphics))
+        vk::Extent3D granularity = qfProperties[i].minImageTransferGranularity;
+        return granularity.width==1 && granularity.height==1 && granularity.depth==1;
+    };
+
+    /*1.图形队列：优先同时支持显示的队列族，使交换链图像可以独占访问*/
+    for(uint32_t i=0; i<qfProperties.size(); i++)
+    {
+        if(!hasFlags(i, vk::QueueFlagBits::eGraphics))
+            continue;
+        bool present = physicalDevice.getSurfaceSupportKHR(i, m_surface);
+        if(!res.graphicsIndex.has_value() || (present && !res.presentIndex.has_value()))
+        {
             res.graphicsIndex = i;
-        if(enablePresentQueue && physicalDevice.getSurfaceSupportKHR(i, m_surface))
+            if(present)
+                res.presentIndex = i;
+        }
+    }
+    /*2.显示队列：图形队列族不支持显示时退而使用其它队列族（交换链图像需共享）*/
+    for(uint32_t i=0; i<qfProperties.size() && !res.presentIndex.has_value(); i++)
+    {
+        if(physicalDevice.getSurfaceSupportKHR(i, m_surface))
             res.presentIndex = i;
-        if(enableComputQueue && (qfProperties[i].queueFlags&vk::QueueFlagBits::eCompute))
+    }
+    if(!res.graphicsIndex.has_value() || !res.presentIndex.has_value())
+    {
+        std::cout << "ERROR: The physical device doesn't support graphics/present queue-family!" << std::endl;   
+        abort();
+    }
+    /*3.计算队列：优先不含图形能力的异步计算队列族，否则与图形队列共用*/
+    res.computeIndex = res.graphicsIndex;
+    for(uint32_t i=0; i<qfProperties.size(); i++)
+    {
+        if(hasFlags(i, vk::QueueFlagBits::eCompute) && !hasFlags(i, vk::QueueFlagBits::eGraphics))
+        {
             res.computeIndex = i;
-
-        if( !((!res.graphicsIndex.has_value())&&enableGraphicsQueue ||
-             (!res.presentIndex.has_value())&&enablePresentQueue   ||
-             (!res.computeIndex.has_value())&&enableComputQueue) )
             break;
+        }
     }
-
-    if((!res.graphicsIndex.has_value())&&enableGraphicsQueue || (!res.presentIndex.has_value())&&enablePresentQueue || (!res.computeIndex.has_value())&&enableComputQueue) 
+    /*4.传输队列：优先只含传输能力的专用队列族（DMA引擎），上传与渲染可并行执行；否则与图形队列共用*/
+    res.transferIndex = res.graphicsIndex;
+    for(uint32_t i=0; i<qfProperties.size(); i++)
     {
-        std::cout << "ERROR: The physical device doesn't support graphics/present/compute queue-family!" << std::endl;   
-        abort();
+        if(hasFlags(i, vk::QueueFlagBits::eTransfer) && !hasFlags(i, vk::QueueFlagBits::eGraphics) && !hasFlags(i, vk::QueueFlagBits::eCompute) && isFineGrained(i))
+        {
+            res.transferIndex = i;
+            break;
+        }
     }
+
+    std::cout << "queue-family: graphics=" << res.graphicsIndex.value() << " present=" << res.presentIndex.value()
+              << " compute=" << res.computeIndex.value() << " transfer=" << res.transferIndex.value() << std::endl;
     return res;
 }
 
@@ -190,48 +250,58 @@ vk::Device VkBase::createLogicalDevice()
         throw std::runtime_error("[ Surface ]: Can't create  surface from external API !");
 
     /*2.指定逻辑设备所需队列*/
-    queueFamilyIndex = queryQueueFamilyIndex(true, true, false);
-    std::vector<float> queuePriorties = {1.f, 1.f, 1.f};
+    queueFamilyIndex = queryQueueFamilyIndex();
+    /*  每个用到的队列族只创建一个队列（多种用途共用同一队列族时共用同一队列）*/
+    std::vector<uint32_t> families = {queueFamilyIndex.graphicsIndex.value(), queueFamilyIndex.presentIndex.value(),
+                                      queueFamilyIndex.computeIndex.value(), queueFamilyIndex.transferIndex.value()};
+    std::sort(families.begin(), families.end());
+    families.erase(std::unique(families.begin(), families.end()), families.end());
+    float queuePriorty = 1.f;
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-    if(queueFamilyIndex.graphicsIndex.has_value())
+    for(uint32_t family : families)
     {
         vk::DeviceQueueCreateInfo queueCreateInfo;
         queueCreateInfo.setPNext(nullptr)
-                       .setPQueuePriorities(&queuePriorties[0])
+                       .setPQueuePriorities(&queuePriorty)
                        .setQueueCount(1)
-                       .setQueueFamilyIndex(queueFamilyIndex.graphicsIndex.value());
-        queueCreateInfos.push_back(queueCreateInfo);
-    }
-    if(queueFamilyIndex.presentIndex.has_value() && (queueFamilyIndex.presentIndex.value()!=queueFamilyIndex.graphicsIndex.value()))
-    {
-        vk::DeviceQueueCreateInfo queueCreateInfo;
-        queueCreateInfo.setPNext(nullptr)
-                       .setPQueuePriorities(&queuePriorties[1])
-                       .setQueueCount(1)
-                       .setQueueFamilyIndex(queueFamilyIndex.presentIndex.value());
-        queueCreateInfos.push_back(queueCreateInfo);
-    }
-    if(queueFamilyIndex.computeIndex.has_value() && (queueFamilyIndex.computeIndex.value()!=queueFamilyIndex.presentIndex.value()) && (queueFamilyIndex.computeIndex.value()!=queueFamilyIndex.graphicsIndex.value()))
-    {
-        vk::DeviceQueueCreateInfo queueCreateInfo;
-        queueCreateInfo.setPNext(nullptr)
-                       .setPQueuePriorities(&queuePriorties[2])
-                       .setQueueCount(1)
-                       .setQueueFamilyIndex(queueFamilyIndex.computeIndex.value());
+                       .setQueueFamilyIndex(family);
         queueCreateInfos.push_back(queueCreateInfo);
     }
     
     /*3.指定逻辑设备所需的物理设备特性（使用所有特性）*/
     vk::PhysicalDeviceFeatures deviceFeatures = physicalDevice.getFeatures();
+    /*  Vulkan1.2/1.3特性：必需的timeline semaphore（队列时间线同步）和synchronization2（资源状态跟踪生成的屏障），
+        可选的buffer device address（顶点拉取）和draw indirect count（GPU驱动绘制）*/
+    vk::PhysicalDeviceVulkan12Features features12 = {};
+    vk::PhysicalDeviceVulkan13Features features13 = {};
+    if(physicalDevice.getProperties().apiVersion<VK_API_VERSION_1_3)
+        throw std::runtime_error("[ LogicalDevice ]: The physical device doesn't support vulkan 1.3!");
+    auto supportedFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features, vk::PhysicalDeviceVulkan13Features>();
+    const auto& supported12 = supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>();
+    const auto& supported13 = supportedFeatures.get<vk::PhysicalDeviceVulkan13Features>();
+    if(!supported12.timelineSemaphore)
+        throw std::runtime_error("[ LogicalDevice ]: The physical device doesn't support timeline semaphore!");
+    if(!supported13.synchronization2)
+        throw std::runtime_error("[ LogicalDevice ]: The physical device doesn't support synchronization2!");
+    features12.setTimelineSemaphore(true)
+              .setBufferDeviceAddress(supported12.bufferDeviceAddress)
+              .setDrawIndirectCount(supported12.drawIndirectCount)
+              .setPNext(&features13);
+    features13.setSynchronization2(true);
+    bufferDeviceAddressSupported = features12.bufferDeviceAddress;
+    drawIndirectCountSupported = features12.drawIndirectCount;
     
     /*4.指定逻辑设备所需拓展*/
     std::vector<const char*> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    memoryBudgetSupported = isDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);   /*可选：查询系统显存预算*/
+    if(memoryBudgetSupported)
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
     
     /*5.指定逻辑设备所需层（使用与实例相同的验证层）*/
     
     /*创建逻辑设备*/
     vk::DeviceCreateInfo deviceCreateInfo = {};
-    deviceCreateInfo.setPNext(nullptr)
+    deviceCreateInfo.setPNext(&features12)
                     .setQueueCreateInfoCount(queueCreateInfos.size())
                     .setQueueCreateInfos(queueCreateInfos)
                     .setPEnabledFeatures(&deviceFeatures)
@@ -242,6 +312,31 @@ vk::Device VkBase::createLogicalDevice()
     return physicalDevice.createDevice(deviceCreateInfo);
 }
 
+bool VkBase::isDeviceExtensionSupported(const char* extensionName)
+{
+    for(auto& e : physicalDevice.enumerateDeviceExtensionProperties())
+    {
+        if(strcmp(e.extensionName, extensionName)==0)
+            return true;
+    }
+    return false;
+}
+
+void VkBase::initMemoryAllocator()
+{
+    allocator = std::make_unique<MemoryAllocator>();
+}
+
+void VkBase::initDeletionQueue()
+{
+    deletionQueue = std::make_unique<DeletionQueue>();
+}
+
+void VkBase::initDefragmenter()
+{
+    defragmenter = std::make_unique<Defragmenter>();
+}
+
 void VkBase::initSwapchain()
 {
     swapchain = std::make_unique<Swapchain>(m_surface); 
@@ -254,6 +349,37 @@ void VkBase::initShaderModules(const std::string& vertexFile, const std::string&
     shader = std::make_unique<Shader>(vertexSource, fragmentSource);
 }
 
+void VkBase::initVertexPullingShader(const std::string& vertexFile, const std::string& fragmentFile)
+{
+    /*顶点拉取需要buffer device address，不支持时仍使用固定顶点输入*/
+    if(!bufferDeviceAddressSupported)
+        return;
+    std::vector<char> vertexSource = utils::readFile(vertexFile);
+    std::vector<char> fragmentSource = utils::readFile(fragmentFile);
+    pullShader = std::make_unique<Shader>(vertexSource, fragmentSource);
+}
+
+void VkBase::initSpriteShader(const std::string& vertexFile, const std::string& instancedVertexFile, const std::string& fragmentFile)
+{
+    /*set 0：顶点着色器中的dynamic uniform缓冲（与主着色器相同）；set 1：片段着色器中的纹理*/
+    vk::DescriptorSetLayoutBinding uniformBinding = {};
+    uniformBinding.setBinding(0)
+                  .setDescriptorCount(1)
+                  .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+                  .setStageFlags(vk::ShaderStageFlagBits::eVertex);
+    vk::DescriptorSetLayoutBinding textureBinding = {};
+    textureBinding.setBinding(0)
+                  .setDescriptorCount(1)
+                  .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                  .setStageFlags(vk::ShaderStageFlagBits::eFragment);
+    std::vector<char> vertexSource = utils::readFile(vertexFile);
+    std::vector<char> fragmentSource = utils::readFile(fragmentFile);
+    std::vector<char> instancedVertexSource = utils::readFile(instancedVertexFile);
+    std::vector<std::vector<vk::DescriptorSetLayoutBinding>> setBindings = {{uniformBinding}, {textureBinding}};
+    spriteShader = std::make_unique<Shader>(vertexSource, fragmentSource, setBindings);
+    spriteInstancedShader = std::make_unique<Shader>(instancedVertexSource, fragmentSource, setBindings);    /*描述符集布局相同，共用精灵管线布局*/
+}
+
 void VkBase::initRenderProcess()
 {
     renderProcess = std::make_unique<RenderProcess>();
@@ -262,58 +388,149 @@ void VkBase::initRenderProcess()
 void VkBase::initPipeline()
 {
     renderProcess->graphicsPipeline_triangle = renderProcess->createGraphicsPipeline(*shader, vk::PrimitiveTopology::eTriangleList);
+    if(pullShader)
+        renderProcess->graphicsPipeline_pull = renderProcess->createGraphicsPipeline(*pullShader, vk::PrimitiveTopology::eTriangleList, true);
+    /*精灵管线：两种混合方式各一条，不剔除（镜像翻转的精灵绕序相反）*/
+    PipelineConfig spriteConfig = {};
+    auto spriteBindings = SpriteVertex::getBindingDescriptions();
+    auto spriteAttributes = SpriteVertex::getAttributeDescriptions();
+    spriteConfig.bindings.assign(spriteBindings.begin(), spriteBindings.end());
+    spriteConfig.attributes.assign(spriteAttributes.begin(), spriteAttributes.end());
+    spriteConfig.layout = renderProcess->spritePipelineLayout;
+    spriteConfig.cullMode = vk::CullModeFlagBits::eNone;
+    spriteConfig.blend = BlendMode::eAlpha;
+    renderProcess->graphicsPipeline_sprite = renderProcess->createGraphicsPipeline(*spriteShader, spriteConfig);
+    spriteConfig.blend = BlendMode::eAdditive;
+    renderProcess->graphicsPipeline_spriteAdditive = renderProcess->createGraphicsPipeline(*spriteShader, spriteConfig);
+    /*实例化精灵管线：binding 0为单位四边形，binding 1为逐实例数据*/
+    auto instanceBindings = SpriteInstance::getBindingDescriptions();
+    auto instanceAttributes = SpriteInstance::getAttributeDescriptions();
+    spriteConfig.bindings.assign(instanceBindings.begin(), instanceBindings.end());
+    spriteConfig.attributes.assign(instanceAttributes.begin(), instanceAttributes.end());
+    spriteConfig.blend = BlendMode::eAlpha;
+    renderProcess->graphicsPipeline_spriteInstanced = renderProcess->createGraphicsPipeline(*spriteInstancedShader, spriteConfig);
+    spriteConfig.blend = BlendMode::eAdditive;
+    renderProcess->graphicsPipeline_spriteInstancedAdditive = renderProcess->createGraphicsPipeline(*spriteInstancedShader, spriteConfig);
+}
+
+void VkBase::initSyncPool()
+{
+    syncPool = std::make_unique<SyncPool>();
 }
 
 void VkBase::initCommandManager()
 {
-    commandManager = std::make_unique<CommandManager>();
+    commandManager = std::make_unique<CommandManager>(queueFamilyIndex.graphicsIndex.value());
+}
+
+void VkBase::initParallelRecorder()
+{
+    parallelRecorder = std::make_unique<ParallelRecorder>();
+}
+
+void VkBase::initTimelines()
+{
+    /*每个提交命令的队列一条时间线*/
+    graphicsTimeline = std::make_unique<Timeline>();
+    if(queueFamilyIndex.transferIndex.value()!=queueFamilyIndex.graphicsIndex.value())
+        transferTimeline = std::make_unique<Timeline>();
+}
+
+void VkBase::initResourceTracker()
+{
+    resourceTracker = std::make_unique<ResourceTracker>();
+}
+
+void VkBase::initCommander()
+{
+    commander = std::make_unique<Commander>(queueFamilyIndex.graphicsIndex.value(), graphicsQueue, *graphicsTimeline);
+    /*存在专用传输队列族时，图像上传走传输队列，与图形队列并行执行*/
+    if(transferTimeline)
+        transferCommander = std::make_unique<Commander>(queueFamilyIndex.transferIndex.value(), transferQueue, *transferTimeline);
 }
 
 void VkBase::initDescriptorManager()
 {
-    descriptorManager = std::make_unique<DescriptorManager>(swapchain->images.size());
+    descriptorManager = std::make_unique<DescriptorManager>(Renderer::maxFlightCount);
+}
+
+
+void VkBase::initMipmapGenerator(const std::string& computeFile)
+{
+    /*计算着色器载入失败时只能使用blit路径*/
+    std::vector<char> computeSource = utils::readFile(computeFile);
+    mipmapGenerator = std::make_unique<MipmapGenerator>(computeSource);
 }
 
+void VkBase::initStagingBelt()
+{
+    stagingBelt = std::make_unique<StagingBelt>();
+}
+
+void VkBase::initUploadScheduler()
+{
+    uploadScheduler = std::make_unique<UploadScheduler>();
+}
+
+void VkBase::initReadback()
+{
+    readback = std::make_unique<Readback>();
+}
 
 void VkBase::initVertexBuffer()
 {
-    size_t bufferSize = sizeof(vertices[0])*vertices.size();
-    /*1.创建临时CPU内存，并将顶点数据通过映射保存到该临时内存中*/
-    Buffer tempBuffer(vk::BufferUsageFlagBits::eTransferSrc, bufferSize, 
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-    memcpy(tempBuffer.data, (void *)vertices.data(), tempBuffer.size);    /*保存顶点数据至映射内存中*/
-    device.unmapMemory(tempBuffer.memory);
-    /*2.创建顶点内存（gpu高效内存）*/
-    vertexBuffer = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eVertexBuffer|vk::BufferUsageFlagBits::eTransferDst, bufferSize,
-                                            vk::MemoryPropertyFlagBits::eDeviceLocal);
-    /*3.拷贝临时内存至顶点内存*/
-    Commander().copyBuffer(tempBuffer.buffer, vertexBuffer->buffer, bufferSize);
+    /*1.创建可增长的顶点数组（gpu高效内存）*/
+    vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eVertexBuffer;
+    if(bufferDeviceAddressSupported)
+        usage |= vk::BufferUsageFlagBits::eStorageBuffer|vk::BufferUsageFlagBits::eShaderDeviceAddress;   /*顶点拉取模式按设备地址读取*/
+    vertexBuffer = std::make_unique<GpuVector<Vertex>>(usage, vertices.size());
+    /*2.顶点数据写入暂存环，等待统一提交拷贝*/
+    vertexBuffer->assign(vertices.begin(), vertices.end());
+    vertexBuffer->upload();
 }
 
 void VkBase::initIndexBuffer()
 {
-    size_t bufferSize = sizeof(indices[0])*indices.size();
-    /*1.创建临时CPU内存，并将顶点数据通过映射保存到该临时内存中*/
-    Buffer tempBuffer(vk::BufferUsageFlagBits::eTransferSrc, bufferSize, 
-                    vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-    memcpy(tempBuffer.data, (void *)indices.data(), tempBuffer.size);    /*保存顶点数据至映射内存中*/
-    device.unmapMemory(tempBuffer.memory);
-    /*2.创建顶点内存（gpu高效内存）*/
-    indexBuffer = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eIndexBuffer|vk::BufferUsageFlagBits::eTransferDst, bufferSize,
-                                            vk::MemoryPropertyFlagBits::eDeviceLocal);
-    /*3.拷贝临时内存至顶点内存*/
-    Commander().copyBuffer(tempBuffer.buffer, indexBuffer->buffer, bufferSize);
+    /*1.创建可增长的顶点索引数组（gpu高效内存）*/
+    indexBuffer = std::make_unique<GpuVector<uint16_t>>(vk::BufferUsageFlagBits::eIndexBuffer, indices.size());
+    /*2.索引数据写入暂存环，等待统一提交拷贝*/
+    indexBuffer->assign(indices.begin(), indices.end());
+    indexBuffer->upload();
+}
+
+void VkBase::initSpriteBatch()
+{
+    spriteBatch = std::make_unique<SpriteBatch>();
+#ifdef VULKAN2D_BENCHMARK
+    spriteBenchmark = std::make_unique<SpriteBenchmark>();
+#endif
+}
+
+void VkBase::initSpriteScene(const std::string& cullFile)
+{
+    /*每个对象一条间接绘制命令（firstInstance为对象下标），需要multiDrawIndirect和drawIndirectFirstInstance；
+      不支持drawIndirectCount时退化为drawIndexedIndirect，剔除掉的对象instanceCount为0*/
+    vk::PhysicalDeviceFeatures features = physicalDevice.getFeatures();
+    if(!features.multiDrawIndirect || !features.drawIndirectFirstInstance)
+        return;
+    std::vector<char> cullSource = utils::readFile(cullFile);
+    if(cullSource.empty())
+    {
+        std::cout << "[ SpriteScene ]: Can't load cull shader, gpu-driven sprites disabled!" << std::endl;   /*剔除着色器载入失败时同样不创建*/
+        return;
+    }
+    spriteScene = std::make_unique<SpriteScene>(cullSource, drawIndirectCountSupported);
 }
 
 void VkBase::initUniformBuffers()
 {
-    int swapchianSize = swapchain->images.size();
-    uniformBuffers.resize(swapchianSize);
-    for(int i=0; i<swapchianSize; i++)
-        uniformBuffers[i] = std::make_unique<Buffer>(vk::BufferUsageFlagBits::eUniformBuffer, sizeof(UniformBufferObject), vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
+    /*所有uniform数据共用一个按帧划分的环形缓冲，子分配按minUniformBufferOffsetAlignment对齐；
+      区段数按最大in-flight帧数划分（与交换链图像数无关），运行期调整帧数无需重建*/
+    vk::DeviceSize alignment = physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+    uniformRing = std::make_unique<RingBuffer>(vk::BufferUsageFlagBits::eUniformBuffer, 1024*1024, Renderer::maxFlightCount, alignment);
 }
 
-void VkBase::updateUniformBuffers(int currentFrame)
+uint32_t VkBase::updateUniformBuffers()
 {
     static auto startTime = std::chrono::high_resolution_clock::now();
     auto currentTime = std::chrono::high_resolution_clock::now();
@@ -325,34 +542,47 @@ void VkBase::updateUniformBuffers(int currentFrame)
     ubo.proj = glm::perspective(glm::radians(45.0f), swapchain->getExtent().width/(float)swapchain->getExtent().height, 0.1f, 20.0f);
     ubo.proj[1][1] *= -1;
 
-    memcpy(uniformBuffers[currentFrame]->data, (void*)&ubo, sizeof(ubo));
+    return uniformRing->push(ubo).offset;   /*返回该次绘制使用的dynamic offset*/
 }
 
 
 void VkBase::initRenderer()
 {
-    renderer = std::make_unique<Renderer>(5);
+    renderer = std::make_unique<Renderer>(2);  /*默认2帧in-flight，运行期可在1~3之间切换*/
 }
 
 void VkBase::recreateSwapchain()
 {
-    /*0.等待设备处于空闲状态*/
-    device.waitIdle();
-
-    /*1.在重建前，销毁有关对象*/
-    commandManager->freeCommandBuffers();
-    swapchain.reset();
-    device.destroyPipeline(renderProcess->graphicsPipeline_triangle);
-    renderProcess.reset();
-
-    /*2.重建交换链相关对象*/
-    m_surface = m_getSurfaceCallback(instance);
-    initSwapchain();
+    /*无需等待设备空闲：旧对象交给延迟销毁队列，待仍在使用它们的帧完成后再销毁*/
+    /*1.保留旧的交换链相关对象*/
+    std::unique_ptr<Swapchain> oldSwapchain = std::move(swapchain);
+    std::unique_ptr<RenderProcess> oldRenderProcess = std::move(renderProcess);
+    vk::Pipeline oldPipeline = oldRenderProcess->graphicsPipeline_triangle;
+    vk::Pipeline oldPullPipeline = oldRenderProcess->graphicsPipeline_pull;
+    vk::Pipeline oldSpritePipeline = oldRenderProcess->graphicsPipeline_sprite;
+    vk::Pipeline oldSpriteAdditivePipeline = oldRenderProcess->graphicsPipeline_spriteAdditive;
+    vk::Pipeline oldInstancedPipeline = oldRenderProcess->graphicsPipeline_spriteInstanced;
+    vk::Pipeline oldInstancedAdditivePipeline = oldRenderProcess->graphicsPipeline_spriteInstancedAdditive;
+
+    /*2.重建交换链相关对象（沿用原surface，并传入旧交换链以便显示引擎复用资源）*/
+    swapchain = std::make_unique<Swapchain>(m_surface, oldSwapchain->swapchain);
     initRenderProcess();
     initPipeline();
     swapchain->initFramebuffers();
-    auto& commandBuffers = renderer->getCommandBuffers();
-    commandBuffers = commandManager->allocateCommandBuffers(renderer->getFlightCount());
+
+    /*3.旧对象按帧号延迟销毁（先framebuffer后render pass）*/
+    deletionQueue->retire(std::move(oldSwapchain));
+    deletionQueue->push([this, oldPipeline, oldPullPipeline, oldSpritePipeline, oldSpriteAdditivePipeline, oldInstancedPipeline, oldInstancedAdditivePipeline]()
+    {
+        device.destroyPipeline(oldPipeline);
+        device.destroyPipeline(oldPullPipeline);
+        device.destroyPipeline(oldSpritePipeline);
+        device.destroyPipeline(oldSpriteAdditivePipeline);
+        device.destroyPipeline(oldInstancedPipeline);
+        device.destroyPipeline(oldInstancedAdditivePipeline);
+    });
+    deletionQueue->retire(std::move(oldRenderProcess));
+    renderer->invalidate();     /*缓存的帧命令缓冲引用了旧的framebuffer和管线*/
 }
 
 
@@ -364,44 +594,16 @@ void VkBase::createTextureImage()
     vk::DeviceSize imageSize = texW * texH * 4;
     if(!pixels)
         throw std::runtime_error("failed to load texture image!");
-    /*2.暂存缓冲*/
-    Buffer tempBuffer(vk::BufferUsageFlagBits::eTransferSrc, imageSize, 
-                        vk::MemoryPropertyFlagBits::eHostVisible|vk::MemoryPropertyFlagBits::eHostCoherent);
-    memcpy(tempBuffer.data, pixels, static_cast<size_t>(tempBuffer.size));
-    device.unmapMemory(tempBuffer.memory);
+    /*2.创建带完整mip链的纹理图像对象（按GPU专用策略从VMA内存块中分配），第0层上传后生成其余层级*/
+    vk::Format format = vk::Format::eR8G8B8A8Srgb;     /*图片像素为sRGB编码，采样时转换为线性值*/
+    uint32_t mipLevels = mipmapGenerator->maxMipLevels(format, static_cast<uint32_t>(texW), static_cast<uint32_t>(texH));
+    texture = std::make_unique<Texture>(static_cast<uint32_t>(texW), static_cast<uint32_t>(texH), format,
+                                        vk::ImageUsageFlagBits::eTransferDst|vk::ImageUsageFlagBits::eSampled, mipLevels);
+    mipmapGenerator->request(*texture);
+    /*3.像素数据交给上传调度（保存副本，可立即释放），首帧就要采样，以最高优先级随暂存环统一提交*/
+    uploadScheduler->scheduleImage(texture->image, static_cast<uint32_t>(texW), static_cast<uint32_t>(texH), pixels, imageSize,
+                                   UploadPriority::eImmediate);
     stbi_image_free(pixels);
-    /*3.创建纹理图像对象*/
-    vk::Extent3D extent = {static_cast<uint32_t>(texW), static_cast<uint32_t>(texH), 1};
-    vk::ImageCreateInfo createInfo = {};
-    createInfo.setImageType(vk::ImageType::e2D)                 /*设置图像对象类型为2D*/
-              .setExtent(extent)                       /*设置图像大小（2D深度为1）*/
-              .setMipLevels(1)                                  /*mipmap仅自身*/
-              .setArrayLayers(1)                                /*纹理数组仅自身*/
-              .setFormat(vk::Format::eR8G8B8A8Snorm)            /*设置图像格式与stbi_load一致*/
-              .setTiling(vk::ImageTiling::eOptimal)             /*设置像素如何排列*/
-              .setInitialLayout(vk::ImageLayout::eUndefined)    /*设置初始化布局*/
-              .setUsage(vk::ImageUsageFlagBits::eTransferDst|vk::ImageUsageFlagBits::eSampled)  /*设置图像对象用途*/
-              .setSharingMode(vk::SharingMode::eExclusive)      /*设置共享模式为队列独有*/
-              .setSamples(vk::SampleCountFlagBits::e1);         /*设置采样数为1*/
-    textureImage = device.createImage(createInfo);
-    if(!textureImage)
-        throw std::runtime_error("failed to create image!");
-    /*4.向纹理图像对象分配并绑定内存*/
-    vk::MemoryRequirements requirements = device.getImageMemoryRequirements(textureImage);
-    vk::MemoryAllocateInfo allocateInfo = {};
-    allocateInfo.setMemoryTypeIndex(findMemoryType(requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal))
-                .setAllocationSize(requirements.size);
-    textureImageMemory = device.allocateMemory(allocateInfo);
-    if(!textureImageMemory)
-        throw std::runtime_error("failed to allocate image memory!");
-    device.bindImageMemory(textureImage, textureImageMemory, 0);
-    /*5.图像对象布局变换*/
-    Commander cmder;
-    cmder.transitionImageLayout(textureImage, vk::Format::eR8G8B8A8Snorm, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-    /*6.复制内存缓冲数据至图像对象*/
-    cmder.copyBuffer(tempBuffer.buffer, textureImage, static_cast<uint32_t>(texW), static_cast<uint32_t>(texH));
-    /*7.将图像对象布局转换成在shader中能够采样的布局*/
-    cmder.transitionImageLayout(textureImage, vk::Format::eR8G8B8A8Snorm, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
 }
 
 
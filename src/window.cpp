@@ -17,6 +17,29 @@ void windowResizedCallback(GLFWwindow* window, int width, int height)
     vulkan2d::VkBase::self().recreateSwapchain();
 }
 
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    /*F12：异步截图，帧完成后写入当前目录*/
+    if(key==GLFW_KEY_F12 && action==GLFW_PRESS)
+        vulkan2d::VkBase::self().readback->saveScreenshot("screenshot.ppm");
+    /*1/2/3：切换in-flight帧数（低延迟/高吞吐），标题栏显示平滑后的帧延迟*/
+    if(key>=GLFW_KEY_1 && key<=GLFW_KEY_3 && action==GLFW_PRESS)
+        vulkan2d::VkBase::self().renderer->setFlightCount(key-GLFW_KEY_1+1);
+    /*I：切换精灵的提交方式（CPU展开顶点/GPU实例化）*/
+    if(key==GLFW_KEY_I && action==GLFW_PRESS)
+    {
+        auto& spriteBatch = *vulkan2d::VkBase::self().spriteBatch;
+        bool instanced = spriteBatch.getMode()==vulkan2d::SpriteMode::eInstanced;
+        spriteBatch.setMode(instanced ? vulkan2d::SpriteMode::eExpanded : vulkan2d::SpriteMode::eInstanced);
+    }
+    /*G：精灵测试场景切换为GPU剔除+间接绘制（仅VULKAN2D_BENCHMARK）*/
+    if(key==GLFW_KEY_G && action==GLFW_PRESS && vulkan2d::VkBase::self().spriteBenchmark)
+    {
+        auto& benchmark = *vulkan2d::VkBase::self().spriteBenchmark;
+        benchmark.setGpuDriven(!benchmark.isGpuDriven());
+    }
+}
+
 void Window::init(int width, int height, const char *title)
 {
     m_self_instance = new Window(width, height, title);
@@ -29,6 +52,7 @@ Window::Window(int width, int height, const char *title)
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     window = glfwCreateWindow(width, height, title, nullptr, nullptr);
     glfwSetWindowSizeCallback(window, windowResizedCallback);
+    glfwSetKeyCallback(window, keyCallback);
 }
 
 void Window::destroy()
@@ -48,7 +72,10 @@ void Window::titleFPS()
     if ((dt = time1 - time0) >= 1) 
     {
         info.precision(1);  /*set 1bit precision*/
-        info << "vulkan2D" << "    " << std::fixed << dframe / dt << " FPS";
+        info << "vulkan2D" << "    " << std::fixed << dframe / dt << " FPS"
+             << "    " << vulkan2d::objectCounters().total() << " sync/cmd objects created"    /*稳态下该计数应保持不变*/
+             << "    " << vulkan2d::VkBase::self().renderer->getFlightCount() << " frames in flight, "
+             << vulkan2d::VkBase::self().renderer->getLatency() << " ms latency";
         glfwSetWindowTitle(window, info.str().c_str());
         info.str("");   //别忘了在设置完窗口标题后清空所用的stringstream
         time0 = time1;